@@ -59,6 +59,9 @@
 /* #include <linux/netdevice.h> */
 /* #include <linux/if_arp.h>    */
 #include <net/if_arp.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <linux/neighbour.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -73,6 +76,9 @@
 #include "config.h"
 #include "intl.h"
 #include "util.h"
+#include "libnetlink.h"
+#include "neigh.h"
+#include "fib.h"
 
 #define DFLT_AF	"inet"
 #define DFLT_HW	"ether"
@@ -88,6 +94,10 @@ int opt_v = 0;			/* debugging output flag        */
 int opt_D = 0;			/* HW-address is devicename     */
 int opt_e = 0;			/* 0=BSD output, 1=new linux    */
 int opt_a = 0;			/* all entries, substring match */
+int opt_proc = 0;		/* read /proc instead of rtnetlink */
+int ap_set = 0;			/* flag if family was set (-A)  */
+int opt_dup = 0;		/* hardware addresses in use more than once */
+char *opt_mac;			/* only entries with this hardware address */
 struct aftype *ap;		/* current address family       */
 struct hwtype *hw;		/* current hardware type        */
 int sockfd = 0;			/* active socket descriptor     */
@@ -386,18 +396,143 @@ static int arp_set(char **args)
 }
 
 
+/* Interface of the main table route towards an address, for entries
+   without a device: what the kernel does for SIOCSARP, but with the
+   table loaded once instead of one route lookup per line. */
+static struct fib_trie arp_routes;
+static int arp_routes_loaded;
+
+static int arp_route_add(struct fib4_entry *e, void *arg)
+{
+    __u32 key[4];
+    void **slot;
+    int ifindex = e->type == RTN_UNICAST ? route_ifindex(e->iface) : 0;
+
+    fib_key4(key, e->dst);
+    slot = fib_trie_insert(&arp_routes, key, e->dst_len);
+    if (*slot == NULL)
+	*slot = (void *) (long) (ifindex > 0 ? ifindex : -1);
+    return 0;
+}
+
+static int arp_route_dev(struct in_addr a)
+{
+    __u32 key[4];
+    long ifindex;
+
+    if (!arp_routes_loaded) {
+	fib_trie_init(&arp_routes, 32);
+	if (fib4_read_netlink(RT_TABLE_MAIN, arp_route_add, NULL) < 0)
+	    fib4_read_proc(arp_route_add, NULL);
+	fib_trie_compress(&arp_routes);
+	arp_routes_loaded = 1;
+    }
+    fib_key4(key, a);
+    ifindex = (long) fib_trie_lookup(&arp_routes, key);
+    return ifindex > 0 ? ifindex : 0;
+}
+
+/*
+ * Turn an ethers line into an RTM_NEWNEIGH request.  Only numeric
+ * addresses are taken; names, -D and the flags only SIOCSARP knows
+ * return 1 and are left to arp_set().  Returns -1 with *err set when the
+ * line is wrong.
+ */
+static int arp_rtnl_set(char **args, struct nlmsghdr *n, int maxlen, const char **err)
+{
+    struct ndmsg *r = NLMSG_DATA(n);
+    struct sockaddr_storage ss;
+    struct in_addr a;
+    char dev[IFNAMSIZ];
+    int pub = 0, temp = 0, type;
+
+    if (opt_D || inet_pton(AF_INET, args[0], &a) != 1)
+	return 1;
+    if (hw->input(args[1], (struct sockaddr *) &ss) < 0) {
+	*err = _("invalid hardware address");
+	return -1;
+    }
+    safe_strncpy(dev, device, sizeof(dev));
+    for (args += 2; *args != NULL; args++) {
+	if (!strcmp(*args, "temp"))
+	    temp = 1;
+	else if (!strcmp(*args, "pub"))
+	    pub = 1;
+	else if (!strcmp(*args, "priv"))
+	    pub = 0;
+	else if (!strcmp(*args, "dev") && args[1])
+	    safe_strncpy(dev, *++args, sizeof(dev));
+	else if (!strcmp(*args, "netmask") && args[1] &&
+		 !strcmp(args[1], "255.255.255.255"))
+	    args++;
+	else
+	    return 1;
+    }
+
+    memset(n, 0, NLMSG_LENGTH(sizeof(*r)));
+    n->nlmsg_len = NLMSG_LENGTH(sizeof(*r));
+    n->nlmsg_type = RTM_NEWNEIGH;
+    n->nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE;
+    r->ndm_family = AF_INET;
+    if (dev[0]) {
+	if ((r->ndm_ifindex = route_ifindex(dev)) <= 0) {
+	    *err = strerror(ENODEV);
+	    return -1;
+	}
+    } else if (pub) {
+	/* the kernel finds the device of a proxy entry by its address */
+	return 1;
+    } else if ((r->ndm_ifindex = arp_route_dev(a)) == 0) {
+	*err = strerror(ENETUNREACH);
+	return -1;
+    }
+    addattr_l(n, maxlen, NDA_DST, &a, sizeof(a));
+    if (pub) {
+	r->ndm_flags = NTF_PROXY;
+	return 0;
+    }
+    neigh_link(r->ndm_ifindex, &type);
+    if (type != hw->type) {
+	*err = _("protocol type mismatch");
+	return -1;
+    }
+    r->ndm_state = temp ? NUD_STALE : NUD_PERMANENT;
+    addattr_l(n, maxlen, NDA_LLADDR, ((struct sockaddr *) &ss)->sa_data, hw->alen);
+    return 0;
+}
+
+static void arp_file_error(__u32 line, int err, void *arg)
+{
+    fprintf(stderr, _("arp: %s:%u: %s\n"), (char *) arg, line, strerror(err));
+}
+
 /* Process an EtherFile */
 static int arp_file(char *name)
 {
     char buff[1024];
     char *sp, *args[32];
-    int linenr, argc;
+    int linenr, argc, entries = 0, failed = 0, rc;
+    const char *err;
+    struct rtnl_handle rth;
+    struct rtnl_batch b;
+    struct {
+	struct nlmsghdr n;
+	struct ndmsg r;
+	char buf[256];
+    } req;
     FILE *fp;
 
     if ((fp = fopen(name, "r")) == NULL) {
 	fprintf(stderr, _("arp: cannot open etherfile %s !\n"), name);
 	return (-1);
     }
+    /* All numeric entries go out over one socket in batches; only the
+       failures are acknowledged. */
+    rth.fd = -1;
+    if (rtnl_open(&rth, 0) == 0 &&
+	rtnl_batch_init(&b, &rth, 0, arp_file_error, name) < 0)
+	rtnl_close(&rth);
+
     /* Read the lines in the file. */
     linenr = 0;
     while (fgets(buff, sizeof(buff), fp) != (char *) NULL) {
@@ -423,29 +558,69 @@ static int arp_file(char *name)
 	    args[1] = args[0];
 	    args[0] = cp;
 	}
-	if (arp_set(args) != 0)
+	entries++;
+	rc = rth.fd < 0 ? 1 : arp_rtnl_set(args, &req.n, sizeof(req), &err);
+	if (rc < 0) {
+	    fprintf(stderr, _("arp: %s:%u: %s\n"), name, linenr, err);
+	    failed++;
+	    continue;
+	}
+	if (rc == 0) {
+	    if ((rc = rtnl_batch_add(&b, &req.n, linenr)) < 0) {
+		perror("RTNETLINK");
+		failed++;
+		break;
+	    }
+	    failed += rc;
+	    continue;
+	}
+	/* keep the order of the file for the entries SIOCSARP sets */
+	if (rth.fd >= 0 && (rc = rtnl_batch_flush(&b)) > 0)
+	    failed += rc;
+	if (arp_set(args) != 0) {
 	    fprintf(stderr, _("arp: cannot set entry on line %u of etherfile %s !\n"),
 		    linenr, name);
+	    failed++;
+	}
+    }
+    if (rth.fd >= 0) {
+	if ((rc = rtnl_batch_flush(&b)) < 0) {
+	    perror("RTNETLINK");
+	    failed++;
+	} else
+	    failed += rc;
+	rtnl_batch_free(&b);
+	rtnl_close(&rth);
     }
+    if (failed)
+	fprintf(stderr, _("arp: %d of %d entries in %s failed.\n"), failed, entries, name);
 
     (void) fclose(fp);
-    return (0);
+    return (failed ? -1 : 0);
 }
 
 
 /* Print the contents of an ARP request block. */
-static void arp_disp_2(const char *name, int type, int arp_flags, const char *hwa, const char *mask, const char *dev)
+static void arp_disp_2(const char *name, int type, int arp_flags, const char *hwa, const char *mask, const char *dev,
+		       const struct neigh_entry *e)
 {
     static int title = 0;
     struct hwtype *xhw;
-    char flags[10];
+    char flags[10], age[24], probes[16];
+    int width = ap->af == AF_INET6 ? 39 : 23;
 
     xhw = get_hwntype(type);
     if (xhw == NULL)
 	xhw = get_hwtype(DFLT_HW);
 
     if (title++ == 0) {
-	printf(_("Address                  HWtype  HWaddress           Flags Mask            Iface\n"));
+	if (ap->af == AF_INET6)
+	    printf(_("Address                                  HWtype  HWaddress           Flags Mask            Iface"));
+	else
+	    printf(_("Address                  HWtype  HWaddress           Flags Mask            Iface"));
+	if (opt_v)
+	    printf(_("           State        Age Probes"));
+	printf("\n");
     }
     /* Setup the flags. */
     flags[0] = '\0';
@@ -465,11 +640,13 @@ static void arp_disp_2(const char *name, int type, int arp_flags, const char *hw
 #endif
     if (arp_flags & ATF_USETRAILERS)
 	strcat(flags, "T");
+    if (e->ntf & NTF_ROUTER)
+	strcat(flags, "R");
 
     if (!(arp_flags & ATF_NETMASK))
 	mask = "";
 
-    printf("%-23.23s  ", name);
+    printf("%-*.*s  ", width, width, name);
 
     if (!(arp_flags & ATF_COM)) {
 	if (arp_flags & ATF_PUBL)
@@ -480,11 +657,23 @@ static void arp_disp_2(const char *name, int type, int arp_flags, const char *hw
 	printf("%-8.8s%-20.20s", xhw->name, hwa);
     }
 
-    printf("%-6.6s%-15.15s %s\n", flags, mask, dev);
+    if (!opt_v) {
+	printf("%-6.6s%-15.15s %s\n", flags, mask, dev);
+	return;
+    }
+    safe_strncpy(age, "-", sizeof(age));
+    if (e->confirmed >= 0)
+	snprintf(age, sizeof(age), "%ld", e->confirmed);
+    safe_strncpy(probes, "-", sizeof(probes));
+    if (e->probes >= 0)
+	snprintf(probes, sizeof(probes), "%d", e->probes);
+    printf("%-6.6s%-15.15s %-15s %-10s %5s %6s\n", flags, mask, dev,
+	   e->state ? neigh_state_name(e->state) : "-", age, probes);
 }
 
 /* Print the contents of an ARP request block. */
-static void arp_disp(const char *name, const char *ip, int type, int arp_flags, const char *hwa, const char *mask, const char *dev)
+static void arp_disp(const char *name, const char *ip, int type, int arp_flags, const char *hwa, const char *mask, const char *dev,
+		     const struct neigh_entry *e)
 {
     struct hwtype *xhw;
 
@@ -520,10 +709,192 @@ static void arp_disp(const char *name, const char *ip, int type, int arp_flags,
 #endif
     if (arp_flags & ATF_USETRAILERS)
 	printf("TRAIL ");
+    if (e->ntf & NTF_ROUTER)
+	printf("ROUTER ");
+
+    printf(_("on %s"), dev);
+    if (opt_v && e->state) {
+	printf(" %s", neigh_state_name(e->state));
+	if (e->confirmed >= 0)
+	    printf(_(" age %lds"), e->confirmed);
+	if (e->probes >= 0)
+	    printf(_(" probes %d"), e->probes);
+    }
+    printf("\n");
+}
 
-    printf(_("on %s\n"), dev);
+/* --duplicates: entries are kept in dump order and chained per
+   hardware address through a hash of the binary addresses. */
+struct arp_mac {
+    int first, last, count;
+};
+
+struct arp_dup {
+    struct neigh_entry *e;
+    int *next;
+    int n, max;
+    struct arp_mac *mac;
+    int macs, size;
+};
+
+struct arp_show {
+    int alen;
+    unsigned char addr[16];
+    int hwlen;
+    unsigned char hwaddr[NEIGH_LLADDR_MAX];
+    struct arp_dup *dup;
+    int entries, showed;
+};
+
+static void arp_show_entry(struct neigh_entry *e)
+{
+    struct sockaddr_storage ss;
+    struct sockaddr *sa = (struct sockaddr *) &ss;
+    char ip[INET6_ADDRSTRLEN], hwa[3 * NEIGH_LLADDR_MAX];
+    const char *hostname;
+    struct aftype *xap = ap;
+
+    inet_ntop(e->family, e->addr, ip, sizeof(ip));
+    if (e->family != ap->af && (xap = get_afntype(e->family)) == NULL)
+	xap = ap;
+    if (opt_n)
+	hostname = "?";
+    else {
+	memset(&ss, 0, sizeof(ss));
+	if (e->family == AF_INET6) {
+	    ss.ss_family = AF_INET6;
+	    memcpy(&((struct sockaddr_in6 *) sa)->sin6_addr, e->addr, 16);
+	} else {
+	    ss.ss_family = AF_INET;
+	    memcpy(&((struct sockaddr_in *) sa)->sin_addr, e->addr, 4);
+	}
+	hostname = xap->sprint(sa, opt_n | 0x8000);
+	if (hostname == NULL || strcmp(hostname, ip) == 0)
+	    hostname = "?";
+    }
+    neigh_lladdr(e, hwa, sizeof(hwa));
+
+    if (opt_e)
+	arp_disp_2(hostname[0] == '?' ? ip : hostname, e->hwtype, e->flags, hwa, "*", e->iface, e);
+    else
+	arp_disp(hostname, ip, e->hwtype, e->flags, hwa, "*", e->iface, e);
+}
+
+static unsigned int arp_mac_hash(const struct neigh_entry *e)
+{
+    return fnv_hash(FNV_INIT, e->lladdr, e->lladdr_len);
+}
+
+static int arp_mac_same(const struct neigh_entry *a, const struct neigh_entry *b)
+{
+    return a->lladdr_len == b->lladdr_len && !memcmp(a->lladdr, b->lladdr, a->lladdr_len);
+}
+
+static void arp_dup_add(struct arp_dup *d, struct neigh_entry *e)
+{
+    unsigned int i, mask;
+    struct arp_mac *m;
+
+    if (d->n == d->max) {
+	d->max = d->max ? d->max * 2 : 1024;
+	d->e = xrealloc(d->e, d->max * sizeof(*d->e));
+	d->next = xrealloc(d->next, d->max * sizeof(*d->next));
+    }
+    if (d->macs * 2 >= d->size) {
+	struct arp_mac *old = d->mac;
+	int j, osize = d->size;
+
+	d->size = d->size ? d->size * 2 : 1024;
+	d->mac = xmalloc(d->size * sizeof(*d->mac));
+	memset(d->mac, 0, d->size * sizeof(*d->mac));
+	mask = d->size - 1;
+	for (j = 0; j < osize; j++) {
+	    if (!old[j].count)
+		continue;
+	    for (i = arp_mac_hash(&d->e[old[j].first]) & mask; d->mac[i].count; i = (i + 1) & mask)
+		;
+	    d->mac[i] = old[j];
+	}
+	free(old);
+    }
+    mask = d->size - 1;
+    for (i = arp_mac_hash(e) & mask; d->mac[i].count; i = (i + 1) & mask)
+	if (arp_mac_same(&d->e[d->mac[i].first], e))
+	    break;
+    m = &d->mac[i];
+    d->e[d->n] = *e;
+    d->next[d->n] = -1;
+    if (m->count++)
+	d->next[m->last] = d->n;
+    else {
+	m->first = d->n;
+	d->macs++;
+    }
+    m->last = d->n++;
 }
 
+/* Every hardware address with more than one protocol address, its
+   entries together, in the order the addresses were first seen. */
+static int arp_dup_show(struct arp_dup *d)
+{
+    unsigned int i, mask = d->size - 1;
+    int j, k, shown = 0, groups = 0;
+
+    for (j = 0; j < d->n; j++) {
+	for (i = arp_mac_hash(&d->e[j]) & mask; ; i = (i + 1) & mask)
+	    if (arp_mac_same(&d->e[d->mac[i].first], &d->e[j]))
+		break;
+	if (d->mac[i].first != j || d->mac[i].count < 2)
+	    continue;
+	groups++;
+	for (k = j; k >= 0; k = d->next[k]) {
+	    arp_show_entry(&d->e[k]);
+	    shown++;
+	}
+    }
+    printf(_("%d hardware addresses shared by %d entries.\n"), groups, shown);
+    free(d->e);
+    free(d->next);
+    free(d->mac);
+    return shown;
+}
+
+static int arp_show_one(struct neigh_entry *e, void *arg)
+{
+    struct arp_show *s = arg;
+
+    /* like /proc/net/arp: nothing for broadcast, multicast and loopback */
+    if (e->family != ap->af || (e->state & NUD_NOARP))
+	return 0;
+
+    s->entries++;
+    /* if the user specified hw-type differs, skip it */
+    if (hw_set && (e->hwtype != hw->type))
+	return 0;
+
+    /* if the user specified address differs, skip it */
+    if (s->alen && memcmp(e->addr, s->addr, s->alen))
+	return 0;
+
+    /* if the user specified device differs, skip it */
+    if (device[0] && strcmp(e->iface, device))
+	return 0;
+
+    /* if the user specified hardware address differs, skip it */
+    if (s->hwlen && (!(e->flags & ATF_COM) || e->lladdr_len != s->hwlen ||
+		     memcmp(e->lladdr, s->hwaddr, s->hwlen)))
+	return 0;
+
+    if (s->dup) {
+	/* only resolved entries have an address to share */
+	if ((e->flags & ATF_COM) && !(e->ntf & NTF_PROXY) && e->lladdr_len)
+	    arp_dup_add(s->dup, e);
+	return 0;
+    }
+    s->showed++;
+    arp_show_entry(e);
+    return 0;
+}
 
 /* Display the contents of the ARP cache in the kernel. */
 static int arp_show(char *name)
@@ -531,17 +902,24 @@ static int arp_show(char *name)
     char host[100];
     struct sockaddr_storage ss;
     struct sockaddr *sa;
-    char ip[100];
-    char hwa[100];
-    char mask[100];
-    char line[200];
-    char dev[100];
-    int type, flags;
-    FILE *fp;
-    const char *hostname;
-    int num, entries = 0, showed = 0;
+    struct arp_show s;
+    struct arp_dup dup;
 
     host[0] = '\0';
+    memset(&s, 0, sizeof(s));
+    if (opt_mac) {
+	/* Binary hardware address to compare with. */
+	if (hw->input(opt_mac, (struct sockaddr *) &ss) < 0) {
+	    fprintf(stderr, _("arp: invalid hardware address\n"));
+	    return (-1);
+	}
+	s.hwlen = hw->alen;
+	memcpy(s.hwaddr, ((struct sockaddr *) &ss)->sa_data, s.hwlen);
+    }
+    if (opt_dup) {
+	memset(&dup, 0, sizeof(dup));
+	s.dup = &dup;
+    }
 
     sa = (struct sockaddr *)&ss;
     if (name != NULL) {
@@ -552,67 +930,309 @@ static int arp_show(char *name)
 	    return (-1);
 	}
 	safe_strncpy(host, ap->sprint(sa, 1), sizeof(host));
+	if (ap->af == AF_INET6) {
+	    s.alen = 16;
+	    memcpy(s.addr, &((struct sockaddr_in6 *) sa)->sin6_addr, 16);
+	} else {
+	    s.alen = 4;
+	    memcpy(s.addr, &((struct sockaddr_in *) sa)->sin_addr, 4);
+	}
     }
-    /* Open the PROCps kernel table. */
-    if ((fp = fopen(_PATH_PROCNET_ARP, "r")) == NULL) {
-	perror(_PATH_PROCNET_ARP);
-	return (-1);
+    /* The rtnetlink dump has IPv6 and the NUD state; /proc only IPv4. */
+    if (opt_proc || neigh_read_netlink(ap->af, arp_show_one, &s) < 0) {
+	if (s.entries || ap->af != AF_INET) {
+	    perror("RTM_GETNEIGH");
+	    return (-1);
+	}
+	if (neigh_read_proc(arp_show_one, &s) < 0) {
+	    perror(_PATH_PROCNET_ARP);
+	    return (-1);
+	}
     }
-    /* Bypass header -- read until newline */
-    if (fgets(line, sizeof(line), fp) != (char *) NULL) {
-	safe_strncpy(mask, "-", sizeof(mask));
-	safe_strncpy(dev, "-", sizeof(dev));
-	/* Read the ARP cache entries. */
-	for (; fgets(line, sizeof(line), fp);) {
-	    num = sscanf(line, "%s 0x%x 0x%x %99s %99s %99s\n",
-			 ip, &type, &flags, hwa, mask, dev);
-	    if (num < 4)
-		break;
+    if (s.dup) {
+	s.showed = arp_dup_show(s.dup);
+	if (opt_v)
+	    printf(_("Entries: %d\tSkipped: %d\tFound: %d\n"), s.entries, s.entries - s.showed, s.showed);
+	return (0);
+    }
+    if (opt_v)
+	printf(_("Entries: %d\tSkipped: %d\tFound: %d\n"), s.entries, s.entries - s.showed, s.showed);
 
-	    entries++;
-	    /* if the user specified hw-type differs, skip it */
-	    if (hw_set && (type != hw->type))
-		continue;
+    if (!s.showed) {
+	if (host[0] && !opt_a)
+	    printf(_("%s (%s) -- no entry\n"), name, host);
+	else if (hw_set || host[0] || device[0] || opt_mac) {
+	    printf(_("arp: in %d entries no match found.\n"), s.entries);
+	}
+    }
+    return (0);
+}
 
-	    /* if the user specified address differs, skip it */
-	    if (host[0] && strcmp(ip, host))
-		continue;
+/*
+ * arp --monitor: follow RTM_NEWNEIGH/RTM_DELNEIGH notifications.  The
+ * state and link layer address of every neighbour are kept, so that
+ * each line can say what changed; the same copy lets an overrun of the
+ * socket buffer be repaired from a fresh dump.
+ */
+struct mon_neigh {
+    struct mon_neigh *next;
+    int family, ifindex;
+    unsigned char addr[16];
+    unsigned int state, ntf;
+    int lladdr_len;
+    unsigned char lladdr[NEIGH_LLADDR_MAX];
+    int mark;
+};
+
+struct arp_mon {
+    struct mon_neigh **hash;
+    unsigned int size, count;
+    struct route_prefix *prefix;
+    int nprefix;
+    int family;
+    int mark, quiet;
+};
+
+static unsigned int arp_mon_hash(const struct arp_mon *m, int family, int ifindex,
+				 const unsigned char *addr)
+{
+    unsigned int h = FNV_INIT ^ (family << 8) ^ ifindex;
 
-	    /* if the user specified device differs, skip it */
-	    if (device[0] && strcmp(dev, device))
-		continue;
+    return fnv_hash(h, addr, family == AF_INET ? 4 : 16) & (m->size - 1);
+}
+
+static struct mon_neigh **arp_mon_find(struct arp_mon *m, const struct neigh_entry *e)
+{
+    struct mon_neigh **np;
+    unsigned int ntf = e->ntf & NTF_PROXY;
+
+    np = &m->hash[arp_mon_hash(m, e->family, e->ifindex, e->addr)];
+    for (; *np; np = &(*np)->next)
+	if ((*np)->family == e->family && (*np)->ifindex == e->ifindex &&
+	    ((*np)->ntf & NTF_PROXY) == ntf &&
+	    !memcmp((*np)->addr, e->addr, sizeof(e->addr)))
+	    break;
+    return np;
+}
+
+static void arp_mon_grow(struct arp_mon *m)
+{
+    struct mon_neigh **old = m->hash, *n, *next;
+    unsigned int i, osize = m->size, h;
+
+    m->size = m->size ? m->size * 2 : 1024;
+    m->hash = xmalloc(m->size * sizeof(*m->hash));
+    memset(m->hash, 0, m->size * sizeof(*m->hash));
+    for (i = 0; i < osize; i++)
+	for (n = old[i]; n; n = next) {
+	    next = n->next;
+	    h = arp_mon_hash(m, n->family, n->ifindex, n->addr);
+	    n->next = m->hash[h];
+	    m->hash[h] = n;
+	}
+    free(old);
+}
+
+static const char *arp_mon_state(unsigned int state)
+{
+    return state ? neigh_state_name(state) : "NONE";
+}
+
+static void arp_mon_row(const char *event, struct neigh_entry *e)
+{
+    char stamp[64];
+
+    printf("%-26s %-21s ", format_timestamp(stamp, sizeof(stamp)), event);
+    arp_show_entry(e);
+    fflush(stdout);
+}
+
+/* Bring the copy up to date with e and print what changed. */
+static void arp_mon_apply(struct arp_mon *m, struct neigh_entry *e, int del)
+{
+    struct mon_neigh **np = arp_mon_find(m, e), *n = *np;
+    char event[64], moved[64], hwa[3 * NEIGH_LLADDR_MAX];
+
+    event[0] = moved[0] = '\0';
+    if (del) {
+	if (!n)
+	    return;
+	*np = n->next;
+	m->count--;
+	snprintf(event, sizeof(event), "%s->DELETED", arp_mon_state(n->state));
+	free(n);
+	if (!m->quiet)
+	    arp_mon_row(event, e);
+	return;
+    }
+    if (!n) {
+	if (m->count >= m->size)
+	    arp_mon_grow(m);
+	n = xmalloc(sizeof(*n));
+	memset(n, 0, sizeof(*n));
+	n->family = e->family;
+	n->ifindex = e->ifindex;
+	n->ntf = e->ntf;
+	memcpy(n->addr, e->addr, sizeof(n->addr));
+	np = &m->hash[arp_mon_hash(m, n->family, n->ifindex, n->addr)];
+	n->next = *np;
+	*np = n;
+	m->count++;
+	snprintf(event, sizeof(event), "NONE->%s", arp_mon_state(e->state));
+    } else {
+	if (e->lladdr_len && n->lladdr_len &&
+	    (e->lladdr_len != n->lladdr_len ||
+	     memcmp(e->lladdr, n->lladdr, e->lladdr_len))) {
+	    /* a neighbour that moved, or two that fight over an address */
+	    struct neigh_entry was = *e;
+
+	    memcpy(was.lladdr, n->lladdr, n->lladdr_len);
+	    was.lladdr_len = n->lladdr_len;
+	    snprintf(moved, sizeof(moved), "was %s", neigh_lladdr(&was, hwa, sizeof(hwa)));
+	}
+	if (e->state != n->state)
+	    snprintf(event, sizeof(event), "%s->%s", arp_mon_state(n->state),
+		     arp_mon_state(e->state));
+    }
+
+    n->mark = m->mark;
+    n->state = e->state;
+    n->ntf = e->ntf;
+    if (e->lladdr_len) {
+	n->lladdr_len = e->lladdr_len;
+	memcpy(n->lladdr, e->lladdr, e->lladdr_len);
+    }
+    if (!m->quiet) {
+	if (event[0])
+	    arp_mon_row(event, e);
+	if (moved[0])
+	    arp_mon_row(moved, e);
+    }
+}
+
+static int arp_mon_want(struct arp_mon *m, struct neigh_entry *e)
+{
+    int i;
+
+    if (m->family != AF_UNSPEC && e->family != m->family)
+	return 0;
+    if (e->state & NUD_NOARP)
+	return 0;
+    if (hw_set && e->hwtype != hw->type)
+	return 0;
+    if (device[0] && strcmp(e->iface, device))
+	return 0;
+    for (i = 0; i < m->nprefix; i++)
+	if (route_prefix_match(&m->prefix[i], e->family, e->addr))
+	    return 1;
+    return m->nprefix == 0;
+}
 
-	    showed++;
-	    /* This IS ugly but it works -be */
-	    if (opt_n)
-		hostname = "?";
-	    else {
-		if (ap->input(0, ip, sa) < 0)
-		    hostname = ip;
-		else
-		    hostname = ap->sprint(sa, opt_n | 0x8000);
-		if (strcmp(hostname, ip) == 0)
-		    hostname = "?";
+static int arp_mon_dump_one(struct neigh_entry *e, void *arg)
+{
+    struct arp_mon *m = arg;
+
+    if (arp_mon_want(m, e))
+	arp_mon_apply(m, e, 0);
+    return 0;
+}
+
+static int arp_mon_msg(struct nlmsghdr *n, void *arg)
+{
+    struct arp_mon *m = arg;
+    struct neigh_entry e;
+
+    if (neigh_parse(n, &e) == 0 && arp_mon_want(m, &e))
+	arp_mon_apply(m, &e, n->nlmsg_type == RTM_DELNEIGH);
+    return 0;
+}
+
+/* Dump the table into the copy; whatever the dump did not see is gone. */
+static int arp_mon_dump(struct arp_mon *m)
+{
+    struct mon_neigh **np, *n;
+    struct neigh_entry e;
+    unsigned int i;
+
+    m->mark++;
+    if (neigh_read_netlink(m->family, arp_mon_dump_one, m) < 0)
+	return -1;
+    for (i = 0; i < m->size; i++)
+	for (np = &m->hash[i]; (n = *np) != NULL;) {
+	    if (n->mark == m->mark) {
+		np = &n->next;
+		continue;
 	    }
+	    memset(&e, 0, sizeof(e));
+	    e.family = n->family;
+	    e.ifindex = n->ifindex;
+	    e.ntf = n->ntf;
+	    memcpy(e.addr, n->addr, sizeof(e.addr));
+	    e.lladdr_len = n->lladdr_len;
+	    memcpy(e.lladdr, n->lladdr, n->lladdr_len);
+	    e.flags = n->ntf & NTF_PROXY ? ATF_PUBL | ATF_PERM : 0;
+	    e.probes = -1;
+	    e.used = e.confirmed = e.updated = -1;
+	    safe_strncpy(e.iface, neigh_link(e.ifindex, &e.hwtype), sizeof(e.iface));
+	    arp_mon_apply(m, &e, 1);
+	}
+    return 0;
+}
 
-	    if (opt_e)
-		arp_disp_2(hostname[0] == '?' ? ip : hostname, type, flags, hwa, mask, dev);
-	    else
-		arp_disp(hostname, ip, type, flags, hwa, mask, dev);
+static int arp_monitor(char **args)
+{
+    struct rtnl_handle rth;
+    struct arp_mon m;
+    char stamp[64];
+
+    memset(&m, 0, sizeof(m));
+    m.family = ap_set ? ap->af : AF_UNSPEC;
+    opt_e = 0;			/* one line per event */
+    for (; *args; args++) {
+	m.prefix = xrealloc(m.prefix, (m.nprefix + 1) * sizeof(*m.prefix));
+	if (route_parse_prefix(*args, &m.prefix[m.nprefix]) < 0) {
+	    fprintf(stderr, _("arp: %s: bad address prefix\n"), *args);
+	    return (-1);
 	}
+	m.nprefix++;
+    }
+    arp_mon_grow(&m);
+
+    /* subscribe before the dump, so nothing falls in between */
+    if (rtnl_open(&rth, RTMGRP_NEIGH) < 0) {
+	perror("rtnetlink");
+	return (-1);
+    }
+    m.quiet = 1;
+    if (arp_mon_dump(&m) < 0) {
+	perror("RTM_GETNEIGH");
+	rtnl_close(&rth);
+	return (-1);
     }
+    m.quiet = 0;
     if (opt_v)
-	printf(_("Entries: %d\tSkipped: %d\tFound: %d\n"), entries, entries - showed, showed);
+	fprintf(stderr, _("arp: following %u neighbours\n"), m.count);
 
-    if (!showed) {
-	if (host[0] && !opt_a)
-	    printf(_("%s (%s) -- no entry\n"), name, host);
-	else if (hw_set || host[0] || device[0]) {
-	    printf(_("arp: in %d entries no match found.\n"), entries);
+    for (;;) {
+	if (rtnl_listen(&rth, arp_mon_msg, &m) == 0)
+	    break;
+	if (errno == EAGAIN || errno == EINTR)
+	    continue;
+	if (errno != ENOBUFS) {
+	    perror("rtnetlink");
+	    break;
 	}
+	/* the kernel had to drop notifications: the rows up to
+	   "resync done" are what a fresh dump found */
+	printf(_("%-26s event queue overrun, resyncing\n"), format_timestamp(stamp, sizeof(stamp)));
+	rtnl_drain(&rth);
+	if (arp_mon_dump(&m) < 0)
+	    perror("RTM_GETNEIGH");
+	printf(_("%-26s resync done\n"), format_timestamp(stamp, sizeof(stamp)));
+	fflush(stdout);
     }
-    (void) fclose(fp);
-    return (0);
+    rtnl_close(&rth);
+    return (-1);
 }
 
 static void version(void)
@@ -627,7 +1247,10 @@ static void usage(void)
     fprintf(stderr, _("  arp [-v]          [-i <if>] -d  <host> [pub]               <-Delete ARP entry\n"));
     fprintf(stderr, _("  arp [-vnD] [<HW>] [-i <if>] -f  [<filename>]            <-Add entry from file\n"));
     fprintf(stderr, _("  arp [-v]   [<HW>] [-i <if>] -s  <host> <hwaddr> [temp]            <-Add entry\n"));
-    fprintf(stderr, _("  arp [-v]   [<HW>] [-i <if>] -Ds <host> <if> [netmask <nm>] pub          <-''-\n\n"));
+    fprintf(stderr, _("  arp [-v]   [<HW>] [-i <if>] -Ds <host> <if> [netmask <nm>] pub          <-''-\n"));
+    fprintf(stderr, _("  arp [-vn]  [<HW>] [-i <if>] [-ae] {--mac <hwaddr>|--duplicates}  <-Entries by HW address\n"));
+    fprintf(stderr, _("  arp [-A <af>] --pressure [<secs>]                       <-Table size against gc_thresh\n"));
+    fprintf(stderr, _("  arp [-vn] [-A <af>] [<HW>] [-i <if>] --monitor [<prefix> ...]  <-Follow changes\n\n"));
 
     fprintf(stderr, _("        -a                       display (all) hosts in alternative (BSD) style\n"));
     fprintf(stderr, _("        -e                       display (all) hosts in default (Linux) style\n"));
@@ -637,8 +1260,9 @@ static void usage(void)
     fprintf(stderr, _("        -n, --numeric            don't resolve names\n"));
     fprintf(stderr, _("        -i, --device             specify network interface (e.g. eth0)\n"));
     fprintf(stderr, _("        -D, --use-device         read <hwaddr> from given device\n"));
-    fprintf(stderr, _("        -A, -p, --protocol       specify protocol family\n"));
-    fprintf(stderr, _("        -f, --file               read new entries from file or from /etc/ethers\n\n"));
+    fprintf(stderr, _("        -A, -p, --protocol       specify protocol family (inet6: display only)\n"));
+    fprintf(stderr, _("        -f, --file               read new entries from file or from /etc/ethers\n"));
+    fprintf(stderr, _("            --proc               read /proc/net/arp instead of rtnetlink\n\n"));
 
     fprintf(stderr, _("  <HW>=Use '-H <hw>' to specify hardware address type. Default: %s\n"), DFLT_HW);
     fprintf(stderr, _("  List of possible hardware types (which support ARP):\n"));
@@ -664,6 +1288,11 @@ int main(int argc, char **argv)
 	{"help", 0, 0, 'h'},
 	{"use-device", 0, 0, 'D'},
 	{"symbolic", 0, 0, 'N'},
+	{"proc", 0, 0, 'P'},
+	{"pressure", 0, 0, 'G'},
+	{"mac", 1, 0, 'M'},
+	{"duplicates", 0, 0, 'U'},
+	{"monitor", 0, 0, 'W'},
 	{NULL, 0, 0, 0}
     };
 
@@ -719,6 +1348,21 @@ int main(int argc, char **argv)
 	case 'v':
 	    opt_v = 1;
 	    break;
+	case 'P':
+	    opt_proc = 1;
+	    break;
+	case 'G':
+	    what = 5;
+	    break;
+	case 'M':
+	    opt_mac = optarg;
+	    break;
+	case 'U':
+	    opt_dup = 1;
+	    break;
+	case 'W':
+	    what = 6;
+	    break;
 
 	case 'A':
 	case 'p':
@@ -728,6 +1372,7 @@ int main(int argc, char **argv)
 			optarg);
 		exit(-1);
 	    }
+	    ap_set = 1;
 	    break;
 	case 'H':
 	case 't':
@@ -751,7 +1396,8 @@ int main(int argc, char **argv)
 	    usage();
 	}
 
-    if (ap->af != AF_INET) {
+    /* IPv6 neighbours can be listed, but not changed */
+    if (ap->af != AF_INET && !(ap->af == AF_INET6 && (what <= 1 || what >= 5) && !opt_proc)) {
 	fprintf(stderr, _("arp: %s: kernel only supports 'inet'.\n"),
 		ap->name);
 	exit(-1);
@@ -796,6 +1442,17 @@ int main(int argc, char **argv)
 	what = arp_set(&argv[optind]);
 	break;
 
+    case 5:			/* compare the tables with the gc thresholds */
+	if (argv[optind] && (argv[optind + 1] || atoi(argv[optind]) <= 0))
+	    usage();
+	what = neigh_pressure(ap_set ? ap->af : AF_UNSPEC,
+			      argv[optind] ? atoi(argv[optind]) : 0);
+	break;
+
+    case 6:			/* follow the changes */
+	what = arp_monitor(&argv[optind]);
+	break;
+
     default:
 	usage();
     }
@@ -23,6 +23,8 @@
  *	    20001008 - Bernd Eckenfels, Patch from RH for setting mtu
  *			(default AF was wrong)
  *          20010404 - Arnaldo Carvalho de Melo, use setlocale
+ *          -b <file>: read many commands, sending link changes through
+ *          batched rtnetlink requests
  */
 
 #define DFLT_AF "inet"
@@ -44,6 +46,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <netdb.h>
+#include <setjmp.h>
 
 /* Ugh.  But libc5 doesn't provide POSIX types.  */
 #include <asm/types.h>
@@ -84,6 +87,7 @@ struct in6_ifreq {
 #include "interface.h"
 #include "sockets.h"
 #include "util.h"
+#include "libnetlink.h"
 
 static char *Release = RELEASE;
 
@@ -92,6 +96,9 @@ int opt_v = 0;			/* debugging output flag        */
 
 int addr_family = 0;		/* currently selected AF        */
 
+static int batch_line = 0;	/* line of the -b file being run */
+static jmp_buf batch_jmp;
+
 /* for ipv4 add/del modes */
 static int get_nmbc_parent(char *parent, in_addr_t *nm, in_addr_t *bc);
 static int set_ifstate(char *parent, in_addr_t ip, in_addr_t nm, in_addr_t bc,
@@ -198,8 +205,20 @@ static int test_flag(char *ifname, short flags)
     return (ifr.ifr_flags & flags);
 }
 
+/* Give up the current command.  In batch mode only the line is lost. */
+static void cmd_exit(int code)
+{
+    if (batch_line)
+	longjmp(batch_jmp, code);
+    exit(code);
+}
+
 static void usage(void)
 {
+    if (batch_line) {
+	fprintf(stderr, _("ifconfig: syntax error\n"));
+	cmd_exit(1);
+    }
     fprintf(stderr, _("Usage:\n  ifconfig [-a] [-v] [-s] <interface> [[<AF>] <address>]\n"));
 #if HAVE_AFINET
     fprintf(stderr, _("  [add <address>[/<prefixlen>]]\n"));
@@ -220,7 +239,8 @@ static void usage(void)
 #ifdef HAVE_DYNAMIC
     fprintf(stderr, _("  [[-]dynamic]\n"));
 #endif
-    fprintf(stderr, _("  [up|down] ...\n\n"));
+    fprintf(stderr, _("  [up|down] ...\n"));
+    fprintf(stderr, _("  ifconfig [-v] -b <file>|-\n\n"));
 
     fprintf(stderr, _("  <HW>=Hardware Type.\n"));
     fprintf(stderr, _("  List of possible hardware types:\n"));
@@ -250,7 +270,8 @@ static int set_netmask(int skfd, struct ifreq *ifr, struct sockaddr *sa)
     return err;
 }
 
-int main(int argc, char **argv)
+/* Run one command, the arguments of an ifconfig call without options. */
+static int ifconfig_cmd(char **spp)
 {
     struct sockaddr_storage _sa, _samask;
     struct sockaddr *sa = (struct sockaddr *)&_sa;
@@ -261,7 +282,6 @@ int main(int argc, char **argv)
     struct hwtype *hw;
     struct ifreq ifr;
     int goterr = 0, didnetmask = 0, neednetmask=0;
-    char **spp;
     int fd;
 #if HAVE_AFINET6
     extern struct aftype inet6_aftype;
@@ -274,64 +294,9 @@ int main(int argc, char **argv)
     extern struct aftype inet_aftype;
 #endif
 
-#if I18N
-    setlocale(LC_ALL, "");
-    bindtextdomain("net-tools", "/usr/share/locale");
-    textdomain("net-tools");
-#endif
-
-    /* Find any options. */
-    argc--;
-    argv++;
-    while (argc && *argv[0] == '-') {
-	if (!strcmp(*argv, "-a"))
-	    opt_a = 1;
-
-	else if (!strcmp(*argv, "-s"))
-	    ife_short = 1;
-
-	else if (!strcmp(*argv, "-v"))
-	    opt_v = 1;
-
-	else if (!strcmp(*argv, "-V") || !strcmp(*argv, "-version") ||
-	    !strcmp(*argv, "--version"))
-	    version();
-
-	else if (!strcmp(*argv, "-?") || !strcmp(*argv, "-h") ||
-	    !strcmp(*argv, "-help") || !strcmp(*argv, "--help"))
-	    usage();
-
-	else {
-	    fprintf(stderr, _("ifconfig: option `%s' not recognised.\n"),
-		    argv[0]);
-	    fprintf(stderr, _("ifconfig: `--help' gives usage information.\n"));
-	    exit(1);
-	}
-
-	argv++;
-	argc--;
-    }
-
-    /* Create a channel to the NET kernel. */
-    if ((skfd = sockets_open(0)) < 0) {
-	perror("socket");
-	exit(1);
-    }
-
-    /* Do we have to show the current setup? */
-    if (argc == 0) {
-	int err = if_print((char *) NULL);
-	(void) close(skfd);
-	exit(err < 0);
-    }
-    /* No. Fetch the interface name. */
-    spp = argv;
     safe_strncpy(ifr.ifr_name, *spp++, IFNAMSIZ);
-    if (*spp == (char *) NULL) {
-	int err = if_print(ifr.ifr_name);
-	(void) close(skfd);
-	exit(err < 0);
-    }
+    if (*spp == (char *) NULL)
+	return (if_print(ifr.ifr_name) < 0);
 
     /* The next argument is either an address family name, or an option. */
     if ((ap = get_aftype(*spp)) != NULL)
@@ -961,14 +926,14 @@ int main(int argc, char **argv)
 	}
 	if (ap->input == NULL) {
 	   fprintf(stderr, _("ifconfig: Cannot set address for this protocol family.\n"));
-	   exit(1);
+	   cmd_exit(1);
 	}
 	if (ap->input(0, host, sa) < 0) {
 	    if (ap->herror)
 	    	ap->herror(host);
 	    else
 	    	fprintf(stderr,_("ifconfig: error resolving '%s' to set address for af=%s\n"), host, ap->name); fprintf(stderr,
-	    _("ifconfig: `--help' gives usage information.\n")); exit(1);
+	    _("ifconfig: `--help' gives usage information.\n")); cmd_exit(1);
 	}
 	memcpy(&ifr.ifr_addr, sa, sizeof(struct sockaddr));
 	{
@@ -979,7 +944,7 @@ int main(int argc, char **argv)
 		fd = get_socket_for_af(AF_INET);
 		if (fd < 0) {
 		    fprintf(stderr, _("No support for INET on this system.\n"));
-		    exit(1);
+		    cmd_exit(1);
 		}
 		r = ioctl(fd, SIOCSIFADDR, &ifr);
 		break;
@@ -989,7 +954,7 @@ int main(int argc, char **argv)
 		fd = get_socket_for_af(AF_ECONET);
 		if (fd < 0) {
 		    fprintf(stderr, _("No support for ECONET on this system.\n"));
-		    exit(1);
+		    cmd_exit(1);
 		}
 		r = ioctl(fd, SIOCSIFADDR, &ifr);
 		break;
@@ -997,7 +962,7 @@ int main(int argc, char **argv)
 	    default:
 		fprintf(stderr,
 		_("Don't know how to set addresses for family %d.\n"), ap->af);
-		exit(1);
+		cmd_exit(1);
 	    }
 	    if (r < 0) {
 		perror("SIOCSIFADDR");
@@ -1036,6 +1001,299 @@ int main(int argc, char **argv)
     return (goterr);
 }
 
+/*
+ * Batch mode (-b).  Every line of the file holds the arguments of one
+ * ifconfig call.  Lines that only change link flags, the mtu or the
+ * txqueuelen of an existing interface become a single RTM_NEWLINK
+ * each, queued and sent to the kernel in batches.  Everything else is
+ * run through ifconfig_cmd() like a command line, after the queued
+ * requests went out, so the order of the file is kept.
+ */
+
+struct batch_ctx {
+    char *file;
+    struct rtnl_batch b;
+    int cached;			/* interface cache holds the full list */
+};
+
+static void batch_error(__u32 line, int err, void *arg)
+{
+    struct batch_ctx *ctx = arg;
+
+    fprintf(stderr, _("ifconfig: %s:%u: %s\n"), ctx->file, line, strerror(err));
+}
+
+/* Turn a link-only command into an RTM_NEWLINK request.  Returns 0 if
+   the line needs the ioctl path instead. */
+static int batch_link_req(struct batch_ctx *ctx, char **args,
+			  struct nlmsghdr *n, int maxlen)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(n);
+    struct interface *ife;
+    char **spp;
+    unsigned flags = 0, change = 0;
+
+    if (strchr(args[0], ':') || args[1] == NULL)
+	return 0;
+
+    memset(n, 0, NLMSG_LENGTH(sizeof(*ifi)));
+    n->nlmsg_len = NLMSG_LENGTH(sizeof(*ifi));
+    n->nlmsg_type = RTM_NEWLINK;
+    n->nlmsg_flags = NLM_F_REQUEST;
+    ifi->ifi_family = AF_UNSPEC;
+
+    for (spp = args + 1; *spp; spp++) {
+	static const struct {
+	    char *name;
+	    unsigned flag;
+	    int set;
+	} kw[] = {
+	    { "up", IFF_UP, 1 },
+	    { "down", IFF_UP, 0 },
+	    { "arp", IFF_NOARP, 0 },
+	    { "-arp", IFF_NOARP, 1 },
+	    { "promisc", IFF_PROMISC, 1 },
+	    { "-promisc", IFF_PROMISC, 0 },
+	    { "allmulti", IFF_ALLMULTI, 1 },
+	    { "-allmulti", IFF_ALLMULTI, 0 },
+	    { "multicast", IFF_MULTICAST, 1 },
+	    { "-multicast", IFF_MULTICAST, 0 },
+#ifdef HAVE_DYNAMIC
+	    { "dynamic", IFF_DYNAMIC, 1 },
+	    { "-dynamic", IFF_DYNAMIC, 0 },
+#endif
+	};
+	int i;
+
+	for (i = 0; i < sizeof(kw) / sizeof(kw[0]); i++)
+	    if (!strcmp(*spp, kw[i].name))
+		break;
+	if (i < sizeof(kw) / sizeof(kw[0])) {
+	    change |= kw[i].flag;
+	    if (kw[i].set)
+		flags |= kw[i].flag;
+	    else
+		flags &= ~kw[i].flag;
+	    continue;
+	}
+	if (!strcmp(*spp, "mtu") && spp[1]) {
+	    addattr32(n, maxlen, IFLA_MTU, atoi(*++spp));
+	    continue;
+	}
+#ifdef HAVE_TXQUEUELEN
+	if (!strcmp(*spp, "txqueuelen") && spp[1]) {
+	    addattr32(n, maxlen, IFLA_TXQLEN, strtoul(*++spp, NULL, 0));
+	    continue;
+	}
+#endif
+	return 0;
+    }
+    ifi->ifi_flags = flags;
+    ifi->ifi_change = change;
+
+    /* The ifindex is all we need from the cache, and it stays valid
+       while we change flags.  A name we don't know may be new: look
+       once more before leaving it to the ioctls to complain. */
+    if (!ctx->cached) {
+	if (if_readlist() < 0)
+	    return 0;
+	ctx->cached = 1;
+    }
+    ife = lookup_interface(args[0]);
+    if (!ife || !ife->ifindex) {
+	if_cache_free();
+	if (if_readlist() < 0) {
+	    ctx->cached = 0;
+	    return 0;
+	}
+	ife = lookup_interface(args[0]);
+	if (!ife || !ife->ifindex)
+	    return 0;
+    }
+    ifi->ifi_index = ife->ifindex;
+    return 1;
+}
+
+static int batch_cmd(char **args)
+{
+    int err;
+
+    if ((err = setjmp(batch_jmp)) != 0)
+	return err;
+    return ifconfig_cmd(args);
+}
+
+static int ifconfig_batch(char *name)
+{
+    struct batch_ctx ctx;
+    struct rtnl_handle rth;
+    struct {
+	struct nlmsghdr n;
+	struct ifinfomsg i;
+	char buf[64];
+    } req;
+    char buff[1024];
+    char *sp, *args[32];
+    int linenr = 0, failed = 0, nl = 0, err;
+    int base_skfd = skfd;
+    FILE *fp;
+
+    if (!strcmp(name, "-"))
+	fp = stdin;
+    else if ((fp = fopen(name, "r")) == NULL) {
+	perror(name);
+	return 1;
+    }
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.file = name;
+    if (rtnl_open(&rth, 0) == 0) {
+	if (rtnl_batch_init(&ctx.b, &rth, 0, batch_error, &ctx) == 0)
+	    nl = 1;
+	else
+	    rtnl_close(&rth);
+    }
+
+    while (fgets(buff, sizeof(buff), fp) != (char *) NULL) {
+	linenr++;
+	if (opt_v)
+	    fprintf(stderr, ">> %s", buff);
+	if ((sp = strchr(buff, '\n')) != (char *) NULL)
+	    *sp = '\0';
+	if (getargs(buff, args) == 0 || args[0][0] == '#' || args[0][0] == '\0')
+	    continue;
+	/* allow a plain list of ifconfig command lines */
+	if (!strcmp(args[0], "ifconfig")) {
+	    memmove(args, args + 1, 31 * sizeof(args[0]));
+	    if (args[0] == NULL)
+		continue;
+	}
+
+	if (nl && batch_link_req(&ctx, args, &req.n, sizeof(req))) {
+	    if ((err = rtnl_batch_add(&ctx.b, &req.n, linenr)) < 0) {
+		perror("RTNETLINK");
+		nl = 0;
+		failed++;
+	    } else
+		failed += err;
+	    continue;
+	}
+
+	if (nl) {
+	    if ((err = rtnl_batch_flush(&ctx.b)) < 0) {
+		perror("RTNETLINK");
+		nl = 0;
+		failed++;
+	    } else
+		failed += err;
+	}
+	/* the ioctls change what the cache knows about the interfaces */
+	if_cache_free();
+	ctx.cached = 0;
+
+	skfd = base_skfd;
+	batch_line = linenr;
+	if (batch_cmd(args) != 0) {
+	    fprintf(stderr, _("ifconfig: %s:%d: command failed\n"), name, linenr);
+	    failed++;
+	}
+	batch_line = 0;
+    }
+    if (nl) {
+	if ((err = rtnl_batch_flush(&ctx.b)) < 0) {
+	    perror("RTNETLINK");
+	    failed++;
+	} else
+	    failed += err;
+    }
+    if (ctx.b.buf) {
+	rtnl_batch_free(&ctx.b);
+	rtnl_close(&rth);
+    }
+    skfd = base_skfd;
+    if (fp != stdin)
+	fclose(fp);
+
+    if (opt_v && failed)
+	fprintf(stderr, _("WARNING: %d command(s) failed.\n"), failed);
+    return (failed != 0);
+}
+
+int main(int argc, char **argv)
+{
+    char *batch = NULL;
+    int goterr;
+
+#if I18N
+    setlocale(LC_ALL, "");
+    bindtextdomain("net-tools", "/usr/share/locale");
+    textdomain("net-tools");
+#endif
+
+    /* Find any options. */
+    argc--;
+    argv++;
+    while (argc && *argv[0] == '-') {
+	if (!strcmp(*argv, "-a"))
+	    opt_a = 1;
+
+	else if (!strcmp(*argv, "-s"))
+	    ife_short = 1;
+
+	else if (!strcmp(*argv, "-v"))
+	    opt_v = 1;
+
+	else if (!strcmp(*argv, "-b")) {
+	    if (argc < 2)
+		usage();
+	    batch = *++argv;
+	    argc--;
+	}
+
+	else if (!strcmp(*argv, "-V") || !strcmp(*argv, "-version") ||
+	    !strcmp(*argv, "--version"))
+	    version();
+
+	else if (!strcmp(*argv, "-?") || !strcmp(*argv, "-h") ||
+	    !strcmp(*argv, "-help") || !strcmp(*argv, "--help"))
+	    usage();
+
+	else {
+	    fprintf(stderr, _("ifconfig: option `%s' not recognised.\n"),
+		    argv[0]);
+	    fprintf(stderr, _("ifconfig: `--help' gives usage information.\n"));
+	    exit(1);
+	}
+
+	argv++;
+	argc--;
+    }
+
+    /* Create a channel to the NET kernel. */
+    if ((skfd = sockets_open(0)) < 0) {
+	perror("socket");
+	exit(1);
+    }
+
+    if (batch) {
+	if (argc != 0)
+	    usage();
+	goterr = ifconfig_batch(batch);
+	(void) close(skfd);
+	exit(goterr);
+    }
+
+    /* Do we have to show the current setup? */
+    if (argc == 0) {
+	int err = if_print((char *) NULL);
+	(void) close(skfd);
+	exit(err < 0);
+    }
+    /* No. Fetch the interface name and do what we are told. */
+    goterr = ifconfig_cmd(argv);
+    exit(goterr);
+}
+
 struct ifcmd {
     int flag;
     unsigned long addr;
@@ -0,0 +1,126 @@
+/*
+ * Binary routing table entries.  The INET and INET6 route readers fill
+ * them either from /proc or from an rtnetlink RTM_GETROUTE dump and hand
+ * them one at a time to a callback, so rows can be printed (or kept)
+ * without going through text addresses first.
+ */
+#ifndef _FIB_H
+#define _FIB_H
+
+#include <stdio.h>
+#include <asm/types.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+struct nlmsghdr;
+struct rtmsg;
+
+struct fib4_entry {
+    struct in_addr dst;
+    struct in_addr gw;
+    struct in_addr mask;
+    unsigned char dst_len;
+    unsigned char type;		/* RTN_*, RTN_UNICAST from /proc    */
+    unsigned char protocol;	/* RTPROT_*, 0 from /proc           */
+    unsigned char tos;		/* 0 from /proc                     */
+    unsigned int table;
+    unsigned int flags;		/* RTF_* as in /proc/net/route      */
+    int metric, refcnt, use;
+    int mss, window, irtt;
+    char iface[IFNAMSIZ];
+};
+
+struct fib6_entry {
+    struct in6_addr dst;
+    struct in6_addr src;
+    struct in6_addr gw;
+    unsigned char dst_len;
+    unsigned char src_len;
+    unsigned char type;
+    unsigned char protocol;
+    unsigned int table;
+    unsigned int flags;		/* RTF_* as in /proc/net/ipv6_route */
+    unsigned int metric;
+    int refcnt, use;
+    char iface[IFNAMSIZ];
+};
+
+typedef int (*fib4_fn)(struct fib4_entry *e, void *arg);
+typedef int (*fib6_fn)(struct fib6_entry *e, void *arg);
+
+/* Table to list: FIB_TABLE_PROC means whatever /proc shows (main for
+   IPv4, all tables for IPv6), RT_TABLE_UNSPEC (0) means all tables. */
+#define FIB_TABLE_PROC	(-1)
+extern int route_table;
+extern int route_parse_table(const char *name, int *table);
+extern const char *route_table_name(int table);
+extern const char *route_ifname(int ifindex);
+extern int route_ifindex(const char *name);
+
+extern int fib4_read_proc(fib4_fn fn, void *arg);
+extern int fib4_read_netlink(int table, fib4_fn fn, void *arg);
+extern int fib4_parse(struct nlmsghdr *n, struct fib4_entry *e);
+extern void fib4_print_head(int ext);
+extern void fib4_print(FILE *fp, const struct fib4_entry *e, int ext, int numeric);
+
+extern int fib6_read_proc(fib6_fn fn, void *arg);
+extern int fib6_read_netlink(int table, fib6_fn fn, void *arg);
+extern int fib6_parse(struct nlmsghdr *n, struct fib6_entry *e, int nh);
+extern void fib6_print_head(void);
+extern void fib6_print(FILE *fp, const struct fib6_entry *e, int numeric);
+
+/* Longest prefix match over host order keys of 32 or 128 bits. */
+struct fib_node {
+    struct fib_node *child[2];
+    __u32 key[4];
+    int plen;
+    void *data;
+};
+
+#define FIB_JUMP_BITS	16
+
+struct fib_trie {
+    struct fib_node *root;
+    struct {
+	struct fib_node *node;
+	void *best;
+    } *jump;
+    int bits;
+    unsigned long nodes;
+};
+
+extern void fib_trie_init(struct fib_trie *t, int bits);
+extern void **fib_trie_insert(struct fib_trie *t, const __u32 *key, int plen);
+extern void fib_trie_compress(struct fib_trie *t);
+extern void *fib_trie_lookup(const struct fib_trie *t, const __u32 *addr);
+extern void fib_trie_free(struct fib_trie *t, void (*fn)(void *));
+extern void fib_trie_walk(const struct fib_trie *t,
+			  void (*fn)(void *data, void *cover, void *arg), void *arg);
+extern void fib_key4(__u32 *key, struct in_addr a);
+extern void fib_key6(__u32 *key, const struct in6_addr *a);
+
+extern int route_lookup(int options, const char *file);
+
+/* route -f: numeric route changes as batched rtnetlink requests. */
+extern struct rtmsg *route_rtnl_init(struct nlmsghdr *n, int maxlen, int action, int family);
+extern const char *INET_rtnl_route(int action, char **args, struct nlmsghdr *n, int maxlen);
+extern const char *INET6_rtnl_route(int action, char **args, struct nlmsghdr *n, int maxlen);
+extern int route_batch(const char *file, const char *afname, int options);
+
+/* route -C prefix: only exceptions for destinations inside it. */
+struct route_prefix {
+    int family;			/* AF_UNSPEC (0): no filter */
+    int plen;
+    unsigned char addr[16];
+};
+extern struct route_prefix route_cache_prefix;
+extern int route_parse_prefix(const char *arg, struct route_prefix *p);
+extern int route_prefix_match(const struct route_prefix *p, int family, const void *addr);
+extern int route_cache_netlink(int family, int numeric, int options);
+
+extern int route_monitor(const char *afname, int options, int interval);
+extern int route_stats(const char *afname, int options);
+extern int route_save(const char *file, const char *afname, int options);
+extern int route_diff(const char *a, const char *b, const char *afname, int options);
+
+#endif
@@ -1,35 +1,80 @@
+#include "util.h"
+
 struct user_net_device_stats {
     unsigned long long rx_packets;	/* total packets received       */
     unsigned long long tx_packets;	/* total packets transmitted    */
     unsigned long long rx_bytes;	/* total bytes received         */
     unsigned long long tx_bytes;	/* total bytes transmitted      */
-    unsigned long rx_errors;	/* bad packets received         */
-    unsigned long tx_errors;	/* packet transmit problems     */
-    unsigned long rx_dropped;	/* no space in linux buffers    */
-    unsigned long tx_dropped;	/* no space available in linux  */
-    unsigned long rx_multicast;	/* multicast packets received   */
-    unsigned long rx_compressed;
-    unsigned long tx_compressed;
-    unsigned long collisions;
+    unsigned long long rx_errors;	/* bad packets received         */
+    unsigned long long tx_errors;	/* packet transmit problems     */
+    unsigned long long rx_dropped;	/* no space in linux buffers    */
+    unsigned long long tx_dropped;	/* no space available in linux  */
+    unsigned long long rx_multicast;	/* multicast packets received   */
+    unsigned long long rx_compressed;
+    unsigned long long tx_compressed;
+    unsigned long long collisions;
 
     /* detailed rx_errors: */
-    unsigned long rx_length_errors;
-    unsigned long rx_over_errors;	/* receiver ring buff overflow  */
-    unsigned long rx_crc_errors;	/* recved pkt with crc error    */
-    unsigned long rx_frame_errors;	/* recv'd frame alignment error */
-    unsigned long rx_fifo_errors;	/* recv'r fifo overrun          */
-    unsigned long rx_missed_errors;	/* receiver missed packet     */
+    unsigned long long rx_length_errors;
+    unsigned long long rx_over_errors;	/* receiver ring buff overflow  */
+    unsigned long long rx_crc_errors;	/* recved pkt with crc error    */
+    unsigned long long rx_frame_errors;	/* recv'd frame alignment error */
+    unsigned long long rx_fifo_errors;	/* recv'r fifo overrun          */
+    unsigned long long rx_missed_errors;	/* receiver missed packet     */
     /* detailed tx_errors */
-    unsigned long tx_aborted_errors;
-    unsigned long tx_carrier_errors;
-    unsigned long tx_fifo_errors;
-    unsigned long tx_heartbeat_errors;
-    unsigned long tx_window_errors;
+    unsigned long long tx_aborted_errors;
+    unsigned long long tx_carrier_errors;
+    unsigned long long tx_fifo_errors;
+    unsigned long long tx_heartbeat_errors;
+    unsigned long long tx_window_errors;
+
+    /* only known through rtnetlink */
+    unsigned long long rx_nohandler;	/* no protocol for the packet   */
+    unsigned long long rx_otherhost_dropped; /* not for our MAC address */
+};
+
+/* Additional protocol addresses, only filled by the rtnetlink backend. */
+struct interface_addr {
+    struct interface_addr *next;
+    int family;
+    int prefixlen;
+    int scope;			/* IPv6: IPV6_ADDR_* scope bits */
+    struct sockaddr_storage addr;
+    struct sockaddr netmask;	/* IPv4 only             */
+    struct sockaddr broadaddr;	/* IPv4 only             */
+    struct sockaddr dstaddr;	/* IPv4 only             */
+};
+
+/* Queueing discipline counters, see if_readqdisc(). */
+struct qdisc_stats {
+    unsigned long long bytes;
+    unsigned long long packets;
+    unsigned int drops;
+    unsigned int overlimits;
+    unsigned int requeues;
+};
+
+struct interface_qdisc {
+    struct interface_qdisc *next;
+    char kind[16];
+    unsigned int handle;
+    unsigned int parent;
+    unsigned int qlen;
+    unsigned int backlog;	/* bytes                 */
+    struct qdisc_stats stats;
+    struct qdisc_stats prev;	/* last dump, for rates  */
+    double interval;		/* seconds since last dump, 0 if none */
+    int seen;
 };
 
 struct interface {
     struct interface *next, *prev;
+    struct interface *hash_next;	/* name hash chain       */
+    struct interface *index_next;	/* ifindex hash chain    */
     char name[IFNAMSIZ];	/* interface name        */
+    struct nstrkey sortkey;	/* nstrcmp() key of name */
+    int ifindex;		/* kernel index, 0 if unknown */
+    int indexed;		/* entered in the ifindex hash */
     short type;			/* if type               */
     short flags;		/* various flags         */
     int mtu;			/* MTU value             */
@@ -58,6 +103,12 @@ struct interface {
     struct user_net_device_stats stats;		/* statistics            */
     int keepalive;		/* keepalive value for SLIP */
     int outfill;		/* outfill value for SLIP */
+    int netlink;		/* filled from rtnetlink, if_fetch has nothing to do */
+    struct interface_addr *addrs; /* secondary IPv4 and all IPv6 addresses */
+    struct user_net_device_stats prev_stats;	/* last sample, for rates */
+    int prev_valid;
+    int prev_ifindex;
+    struct interface_qdisc *qdiscs; /* root and child qdiscs */
 };
 
 extern int if_fetch(struct interface *ife);
@@ -65,7 +116,9 @@ extern int if_fetch(struct interface *ife);
 extern int for_all_interfaces(int (*)(struct interface *, void *), void *);
 extern int if_cache_free(void);
 extern struct interface *lookup_interface(char *name);
+extern struct interface *lookup_interface_index(int ifindex);
 extern int if_readlist(void);
+extern int if_readqdisc(void);
 
 extern int do_if_fetch(struct interface *ife);
 extern int do_if_print(struct interface *ife, void *cookie);
@@ -77,6 +130,7 @@ extern char * get_name(char **namep, char *p);
 extern void ife_print(struct interface *ptr);
 
 extern int ife_short;
+extern int if_qdisc_stats;
 
 extern const char *if_port_text[][4];
 
@@ -0,0 +1,58 @@
+#ifndef __LIBNETLINK_H__
+#define __LIBNETLINK_H__ 1
+
+#include <asm/types.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+struct rtnl_handle
+{
+	int			fd;
+	struct sockaddr_nl	local;
+	struct sockaddr_nl	peer;
+	__u32			seq;
+	__u32			dump;
+};
+
+typedef int (*rtnl_filter_t)(struct nlmsghdr *n, void *arg);
+typedef void (*rtnl_error_t)(__u32 tag, int err, void *arg);
+
+/* Requests queued with rtnl_batch_add go out in as few sendmsg calls as
+   possible; only failing requests are acknowledged by the kernel. */
+struct rtnl_batch
+{
+	struct rtnl_handle	*rth;
+	char			*buf;
+	int			len;
+	int			tail;
+	int			size;
+	int			count;
+	int			max;
+	__u32			*tag;
+	__u32			first;
+	rtnl_error_t		error;
+	void			*arg;
+};
+
+extern int rtnl_open(struct rtnl_handle *rth, unsigned subscriptions);
+extern void rtnl_close(struct rtnl_handle *rth);
+extern int rtnl_wilddump_request(struct rtnl_handle *rth, int fam, int type);
+extern int rtnl_dump_request(struct rtnl_handle *rth, int type, void *req, int len);
+extern int rtnl_dump_filter(struct rtnl_handle *rth, rtnl_filter_t filter, void *arg);
+extern int rtnl_listen(struct rtnl_handle *rth, rtnl_filter_t handler, void *arg);
+extern void rtnl_drain(struct rtnl_handle *rth);
+
+extern int rtnl_batch_init(struct rtnl_batch *b, struct rtnl_handle *rth,
+			   int max, rtnl_error_t error, void *arg);
+extern int rtnl_batch_add(struct rtnl_batch *b, struct nlmsghdr *n, __u32 tag);
+extern int rtnl_batch_flush(struct rtnl_batch *b);
+extern void rtnl_batch_free(struct rtnl_batch *b);
+
+extern int addattr32(struct nlmsghdr *n, int maxlen, int type, __u32 data);
+extern int addattr_l(struct nlmsghdr *n, int maxlen, int type, const void *data, int alen);
+extern int rta_addattr32(struct rtattr *rta, int maxlen, int type, __u32 data);
+extern int parse_rtattr(struct rtattr *tb[], int max, struct rtattr *rta, int len);
+
+#define RTA_U32(rta)	(*(__u32 *) RTA_DATA(rta))
+
+#endif /* __LIBNETLINK_H__ */
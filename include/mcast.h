@@ -0,0 +1,47 @@
+/*
+ * Binary multicast group memberships.  The readers fill them either from
+ * /proc (dev_mcast, igmp, igmp6) or from an rtnetlink RTM_GETMULTICAST
+ * dump and hand them one at a time to a callback, the same way neigh.h
+ * does for neighbours.
+ */
+#ifndef _MCAST_H
+#define _MCAST_H
+
+#include <asm/types.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#define MCAST_ADDR_MAX	32
+
+#define MCAST_STATIC	0x01		/* link address added by SIOCADDMULTI */
+#define MCAST_REPORTER	0x02		/* this host sent the last report */
+
+struct mcast_entry {
+    int family;				/* AF_INET, AF_INET6, AF_PACKET     */
+    int ifindex;
+    int users;				/* -1 when not known                */
+    unsigned int flags;			/* MCAST_*                          */
+    int alen;
+    unsigned char group[MCAST_ADDR_MAX];
+    char iface[IFNAMSIZ];
+};
+
+typedef int (*mcast_fn)(struct mcast_entry *e, void *arg);
+
+/* ifindex 0 reads all interfaces. */
+extern int mcast_read_proc(int family, int ifindex, mcast_fn fn, void *arg);
+extern int mcast_read_netlink(int family, int ifindex, mcast_fn fn, void *arg);
+
+/* One row per group of a family: on how many interfaces it is joined and
+   by how many users in all. */
+struct mcast_group {
+    int family;
+    int alen;
+    unsigned char group[MCAST_ADDR_MAX];
+    int ifaces;
+    long users;
+};
+
+extern struct mcast_group *mcast_groups(int family, int *count);
+
+#endif
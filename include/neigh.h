@@ -0,0 +1,43 @@
+/*
+ * Binary neighbour table entries.  The readers fill them either from
+ * /proc/net/arp or from an rtnetlink RTM_GETNEIGH dump and hand them one
+ * at a time to a callback, the same way fib.h does for routes.
+ */
+#ifndef _NEIGH_H
+#define _NEIGH_H
+
+#include <asm/types.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+struct nlmsghdr;
+
+#define NEIGH_LLADDR_MAX	32
+
+struct neigh_entry {
+    int family;
+    unsigned char addr[16];
+    unsigned char lladdr[NEIGH_LLADDR_MAX];
+    int lladdr_len;
+    int hwtype;			/* ARPHRD_* of the device           */
+    int flags;			/* ATF_* as in /proc/net/arp        */
+    unsigned int state;		/* NUD_*, 0 from /proc              */
+    unsigned int ntf;		/* NTF_ROUTER, NTF_PROXY            */
+    int ifindex;
+    int probes;			/* -1 when not known                */
+    long used, confirmed, updated;	/* seconds ago, -1 when not known   */
+    char iface[IFNAMSIZ];
+};
+
+typedef int (*neigh_fn)(struct neigh_entry *e, void *arg);
+
+extern const char *neigh_link(int ifindex, int *hwtype);
+extern int neigh_parse(struct nlmsghdr *n, struct neigh_entry *e);
+extern int neigh_read_proc(neigh_fn fn, void *arg);
+extern int neigh_read_netlink(int family, neigh_fn fn, void *arg);
+extern const char *neigh_state_name(unsigned int state);
+extern char *neigh_lladdr(const struct neigh_entry *e, char *buf, int len);
+
+extern int neigh_pressure(int family, int interval);
+
+#endif
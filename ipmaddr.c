@@ -37,9 +37,11 @@
 #include "net-support.h"
 #include "version.h"
 #include "pathnames.h"
+#include "mcast.h"
 
 char filter_dev[16];
 int  filter_family;
+int  filter_index;
 
 /* These have nothing to do with rtnetlink. :-) */
 #define NEWADDR		1
@@ -95,148 +97,112 @@ static int parse_lla(char *str, char *addr)
 	return len;
 }
 
-static int parse_hex(char *str, unsigned char *addr)
-{
-	int len=0;
-
-	while (*str) {
-		int tmp;
-		if (str[1] == 0)
-			return -1;
-		if (sscanf(str, "%02x", &tmp) != 1)
-			return -1;
-		addr[len] = tmp;
-		len++;
-		str += 2;
-	}
-	return len;
-}
-
 struct ma_info
 {
-	struct ma_info *next;
 	int		index;
-	int		users;
+	int		users;		/* -1 when not known */
+	int		seq;
 	char		*features;
 	char		name[IFNAMSIZ];
 	inet_prefix	addr;
 };
 
-void maddr_ins(struct ma_info **lst, struct ma_info *m)
+/* Memberships are collected unsorted and sorted by interface once;
+   thousands of groups per interface made sorted insertion quadratic. */
+struct ma_list
 {
-	struct ma_info *mp;
-
-	for (; (mp=*lst) != NULL; lst = &mp->next) {
-		if (mp->index > m->index)
-			break;
-	}
-	m->next = *lst;
-	*lst = m;
-}
+	struct ma_info	*ma;
+	int		count;
+	int		size;
+};
 
-void read_dev_mcast(struct ma_info **result_p)
+static struct ma_info *maddr_new(struct ma_list *lst)
 {
-	char buf[256];
-	FILE *fp = fopen(_PATH_PROCNET_DEV_MCAST, "r");
+	struct ma_info *m;
 
-	if (!fp)
-		return;
-
-	while (fgets(buf, sizeof(buf), fp)) {
-		char hexa[256];
-		struct ma_info m;
-		int len;
-		int st;
-
-		memset(&m, 0, sizeof(m));
-		sscanf(buf, "%d%s%d%d%s", &m.index, m.name, &m.users, &st,
-		       hexa);
-		if (filter_dev[0] && strcmp(filter_dev, m.name))
-			continue;
-
-		m.addr.family = AF_PACKET;
-
-		len = parse_hex(hexa, (unsigned char*)&m.addr.data);
-		if (len >= 0) {
-			struct ma_info *ma = xmalloc(sizeof(m));
-			memcpy(ma, &m, sizeof(m));
-			ma->addr.bytelen = len;
-			ma->addr.bitlen = len<<3;
-			if (st)
-				ma->features = "static";
-			maddr_ins(result_p, ma);
-		}
+	if (lst->count == lst->size) {
+		lst->size = lst->size ? lst->size * 2 : 256;
+		lst->ma = xrealloc(lst->ma, lst->size * sizeof(*lst->ma));
 	}
-	fclose(fp);
+	m = &lst->ma[lst->count];
+	memset(m, 0, sizeof(*m));
+	m->seq = lst->count++;
+	return m;
 }
 
-void read_igmp(struct ma_info **result_p)
+/* By interface, and in the order read within one. */
+static int maddr_cmp(const void *a, const void *b)
 {
-	struct ma_info m, *ma = NULL;
-	char buf[256];
-	FILE *fp = fopen(_PATH_PROCNET_IGMP, "r");
+	const struct ma_info *x = a, *y = b;
 
-	if (!fp)
-		return;
-	memset(&m, 0, sizeof(m));
-	if (fgets(buf, sizeof(buf), fp))
-		/* eat line */;
-
-	m.addr.family = AF_INET;
-	m.addr.bitlen = 32;
-	m.addr.bytelen = 4;
-
-	while (fgets(buf, sizeof(buf), fp)) {
-		if (buf[0] != '\t') {
-			sscanf(buf, "%d%s", &m.index, m.name);
-			continue;
-		}
+	if (x->index != y->index)
+		return x->index < y->index ? -1 : 1;
+	return x->seq - y->seq;
+}
 
-		if (filter_dev[0] && strcmp(filter_dev, m.name))
-			continue;
+static int store_maddr(struct mcast_entry *e, void *arg)
+{
+	struct ma_info *ma = maddr_new(arg);
+
+	ma->index = e->ifindex;
+	ma->users = e->users;
+	if (e->flags & MCAST_STATIC)
+		ma->features = "static";
+	safe_strncpy(ma->name, e->iface, sizeof(ma->name));
+	ma->addr.family = e->family;
+	ma->addr.bytelen = e->alen;
+	ma->addr.bitlen = e->alen<<3;
+	memcpy(ma->addr.data, e->group, e->alen);
+	return 0;
+}
 
-		sscanf(buf, "%08x%d", (__u32*)&m.addr.data, &m.users);
+/* Group addresses of one family, for looking up the netlink entries. */
+static int maddr_addr_cmp(const void *a, const void *b)
+{
+	const struct ma_info *x = a, *y = b;
 
-		ma = xmalloc(sizeof(m));
-		memcpy(ma, &m, sizeof(m));
-		maddr_ins(result_p, ma);
-	}
-	fclose(fp);
+	return memcmp(x->addr.data, y->addr.data, x->addr.bytelen);
 }
 
+struct ma_users
+{
+	struct ma_info	*ma;
+	int		count;
+};
 
-void read_igmp6(struct ma_info **result_p)
+static int merge_users(struct mcast_entry *e, void *arg)
 {
-	char buf[256];
-	FILE *fp = fopen(_PATH_PROCNET_IGMP6, "r");
+	struct ma_users *u = arg;
+	struct ma_info key, *ma;
+
+	memcpy(key.addr.data, e->group, e->alen);
+	key.addr.bytelen = e->alen;
+	ma = bsearch(&key, u->ma, u->count, sizeof(*u->ma), maddr_addr_cmp);
+	if (ma)
+		ma->users = e->users;
+	return 0;
+}
 
-	if (!fp)
+/* With a device given, its IPv4 and IPv6 groups come from an
+   RTM_GETMULTICAST dump the kernel limits to it.  The dump does not have
+   the number of users of a group; that is taken from the rows of the
+   same device in /proc.  Without a device all of /proc is read. */
+static void read_maddr(struct ma_list *lst, int family)
+{
+	int count = lst->count;
+	struct ma_users u;
+
+	if (family != AF_PACKET && filter_index &&
+	    mcast_read_netlink(family, filter_index, store_maddr, lst) >= 0) {
+		/* the final sort by interface and seq restores the order */
+		u.ma = lst->ma + count;
+		u.count = lst->count - count;
+		qsort(u.ma, u.count, sizeof(*u.ma), maddr_addr_cmp);
+		mcast_read_proc(family, filter_index, merge_users, &u);
 		return;
-
-	while (fgets(buf, sizeof(buf), fp)) {
-		char hexa[256];
-		struct ma_info m;
-		int len;
-
-		memset(&m, 0, sizeof(m));
-		sscanf(buf, "%d%s%s%d", &m.index, m.name, hexa, &m.users);
-
-		if (filter_dev[0] && strcmp(filter_dev, m.name))
-			continue;
-
-		m.addr.family = AF_INET6;
-
-		len = parse_hex(hexa, (unsigned char*)&m.addr.data);
-		if (len >= 0) {
-			struct ma_info *ma = xmalloc(sizeof(m));
-			memcpy(ma, &m, sizeof(m));
-
-			ma->addr.bytelen = len;
-			ma->addr.bitlen = len<<3;
-			maddr_ins(result_p, ma);
-		}
 	}
-	fclose(fp);
+	lst->count = count;
+	mcast_read_proc(family, filter_index, store_maddr, lst);
 }
 
 static void print_maddr(FILE *fp, struct ma_info *list)
@@ -264,18 +230,20 @@ static void print_maddr(FILE *fp, struct ma_info *list)
 		else
 			fprintf(fp, "?");
 	}
-	if (list->users != 1)
+	if (list->users >= 0 && list->users != 1)
 		fprintf(fp, _(" users %d"), list->users);
 	if (list->features)
 		fprintf(fp, " %s", list->features);
 	fprintf(fp, "\n");
 }
 
-static void print_mlist(FILE *fp, struct ma_info *list)
+static void print_mlist(FILE *fp, struct ma_list *lst)
 {
+	struct ma_info *list;
 	int cur_index = 0;
 
-	for (; list; list = list->next) {
+	qsort(lst->ma, lst->count, sizeof(*lst->ma), maddr_cmp);
+	for (list = lst->ma; list < lst->ma + lst->count; list++) {
 		if (cur_index != list->index) {
 			cur_index = list->index;
 			fprintf(fp, "%d:\t%s\n", cur_index, list->name);
@@ -286,9 +254,11 @@ static void print_mlist(FILE *fp, struct ma_info *list)
 
 static int multiaddr_list(int argc, char **argv)
 {
-	struct ma_info *list = NULL;
+	struct ma_list list;
 	size_t l;
 
+	memset(&list, 0, sizeof(list));
+
 	while (argc > 0) {
 		if (strcmp(*argv, "dev") == 0) {
 			NEXT_ARG();
@@ -313,13 +283,17 @@ static int multiaddr_list(int argc, char **argv)
 		argv++; argc--;
 	}
 
+	if (filter_dev[0] && (filter_index = if_nametoindex(filter_dev)) == 0)
+		return 0;
+
 	if (!filter_family || filter_family == AF_PACKET)
-		read_dev_mcast(&list);
+		read_maddr(&list, AF_PACKET);
 	if (!filter_family || filter_family == AF_INET)
-		read_igmp(&list);
+		read_maddr(&list, AF_INET);
 	if (!filter_family || filter_family == AF_INET6)
-		read_igmp6(&list);
-	print_mlist(stdout, list);
+		read_maddr(&list, AF_INET6);
+	print_mlist(stdout, &list);
+	free(list.ma);
 	return 0;
 }
 
@@ -463,7 +463,7 @@ void print_tunnel(struct ip_tunnel_parm *p)
 static int do_tunnels_list(struct ip_tunnel_parm *p)
 {
 	char name[IFNAMSIZ];
-	unsigned long  rx_bytes, rx_packets, rx_errs, rx_drops,
+	unsigned long long rx_bytes, rx_packets, rx_errs, rx_drops,
 	rx_fifo, rx_frame,
 	tx_bytes, tx_packets, tx_errs, tx_drops,
 	tx_fifo, tx_colls, tx_carrier, rx_multi;
@@ -491,7 +491,7 @@ static int do_tunnels_list(struct ip_tunnel_parm *p)
 			fclose(fp);
 			return -1;
 		}
-		if (sscanf(ptr, "%ld%ld%ld%ld%ld%ld%ld%*d%ld%ld%ld%ld%ld%ld%ld",
+		if (sscanf(ptr, "%Lu%Lu%Lu%Lu%Lu%Lu%*u%Lu%Lu%Lu%Lu%Lu%Lu%Lu%Lu",
 			   &rx_bytes, &rx_packets, &rx_errs, &rx_drops,
 			   &rx_fifo, &rx_frame, &rx_multi,
 			   &tx_bytes, &tx_packets, &tx_errs, &tx_drops,
@@ -518,10 +518,10 @@ static int do_tunnels_list(struct ip_tunnel_parm *p)
 		print_tunnel(&p1);
 		if (show_stats) {
 			printf(_("RX: Packets    Bytes        Errors CsumErrs OutOfSeq Mcasts\n"));
-			printf("    %-10ld %-12ld %-6ld %-8ld %-8ld %-8ld\n",
+			printf("    %-10llu %-12llu %-6llu %-8llu %-8llu %-8llu\n",
 			       rx_packets, rx_bytes, rx_errs, rx_frame, rx_fifo, rx_multi);
 			printf(_("TX: Packets    Bytes        Errors DeadLoop NoRoute  NoBufs\n"));
-			printf("    %-10ld %-12ld %-6ld %-8ld %-8ld %-6ld\n\n",
+			printf("    %-10llu %-12llu %-6llu %-8llu %-8llu %-6llu\n\n",
 			       tx_packets, tx_bytes, tx_errs, tx_colls, tx_carrier, tx_drops);
 		}
 	}
@@ -0,0 +1,198 @@
+/*
+ * lib/cacheroute.c	List the route exceptions (PMTU and redirect
+ *			entries) the kernel keeps next to the FIB, for
+ *			"route -C" and "netstat -rC".
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		/proc/net/rt_cache went away with the IPv4 routing cache,
+ *		and /proc/net/ipv6_route never showed the exceptions that
+ *		replaced the IPv6 one.  An RTM_GETROUTE dump with
+ *		RTM_F_CLONED set asks for the exceptions only, so they are
+ *		streamed to the output without the routes they hang off.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include "config.h"
+#include "net-support.h"
+#include "intl.h"
+#include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
+
+#ifndef RTCF_REDIRECTED
+#define RTCF_REDIRECTED	0x00040000
+#endif
+
+extern struct aftype inet_aftype;
+extern struct aftype inet6_aftype;
+
+struct route_prefix route_cache_prefix;
+
+struct cache_show {
+    int family;
+    int numeric;
+    long hz;
+    unsigned long seen, rows;
+};
+
+static const char *cache_addr(int family, const void *addr, int numeric)
+{
+    struct sockaddr_storage ss;
+
+    memset(&ss, 0, sizeof(ss));
+    if (family == AF_INET) {
+	struct sockaddr_in *sin = (struct sockaddr_in *) &ss;
+
+	sin->sin_family = AF_INET;
+	memcpy(&sin->sin_addr, addr, 4);
+	return inet_aftype.sprint((struct sockaddr *) sin, numeric);
+    }
+    ((struct sockaddr_in6 *) &ss)->sin6_family = AF_INET6;
+    memcpy(&((struct sockaddr_in6 *) &ss)->sin6_addr, addr, 16);
+    return inet6_aftype.sprint((struct sockaddr *) &ss, numeric);
+}
+
+static void cache_print_head(int family)
+{
+    if (family == AF_INET)
+	printf(_("Destination     Gateway         Flags   MTU Expires Iface\n"));
+    else
+	printf(_("Destination                    Next Hop                   "
+		 "Flag   MTU Expires If\n"));
+}
+
+static int cache_show(struct nlmsghdr *n, void *arg)
+{
+    struct cache_show *s = arg;
+    struct rtmsg *r = NLMSG_DATA(n);
+    struct rtattr *tb[RTA_MAX + 1];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+    int alen = s->family == AF_INET ? 4 : 16;
+    unsigned char dst[16];
+    unsigned int mtu = 0;
+    char daddr[128], gaddr[128], flags[8], expires[16];
+    const char *ifname;
+    long secs = -1;
+    int f = 0;
+
+    if (n->nlmsg_type != RTM_NEWROUTE || len < 0 || r->rtm_family != s->family)
+	return 0;
+    /* kernels that cannot dump exceptions send the whole FIB */
+    if (!(r->rtm_flags & RTM_F_CLONED))
+	return 0;
+    s->seen++;
+    parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+
+    memset(dst, 0, sizeof(dst));
+    if (tb[RTA_DST])
+	memcpy(dst, RTA_DATA(tb[RTA_DST]), alen);
+    if (!route_prefix_match(&route_cache_prefix, s->family, dst))
+	return 0;
+
+    if (tb[RTA_METRICS]) {
+	struct rtattr *mx[RTAX_MAX + 1];
+
+	parse_rtattr(mx, RTAX_MAX, RTA_DATA(tb[RTA_METRICS]),
+		     RTA_PAYLOAD(tb[RTA_METRICS]));
+	if (mx[RTAX_MTU])
+	    mtu = RTA_U32(mx[RTAX_MTU]);
+    }
+    if (tb[RTA_CACHEINFO]) {
+	struct rta_cacheinfo *ci = RTA_DATA(tb[RTA_CACHEINFO]);
+
+	if (ci->rta_expires)
+	    secs = (long) (__s32) ci->rta_expires / s->hz;
+    }
+    ifname = route_ifname(tb[RTA_OIF] ? RTA_U32(tb[RTA_OIF]) : 0);
+
+    flags[f++] = 'U';
+    if (tb[RTA_GATEWAY])
+	flags[f++] = 'G';
+    if (r->rtm_dst_len == alen * 8)
+	flags[f++] = 'H';
+    if (r->rtm_flags & RTCF_REDIRECTED)
+	flags[f++] = 'D';
+    if (mtu)
+	flags[f++] = 'M';
+    flags[f] = '\0';
+
+    safe_strncpy(daddr, cache_addr(s->family, dst, s->numeric), sizeof(daddr));
+    if (tb[RTA_GATEWAY])
+	safe_strncpy(gaddr, cache_addr(s->family, RTA_DATA(tb[RTA_GATEWAY]),
+				       s->numeric), sizeof(gaddr));
+    else
+	safe_strncpy(gaddr, s->family == AF_INET ? "*" : "::", sizeof(gaddr));
+    if (secs >= 0)
+	snprintf(expires, sizeof(expires), "%ld", secs);
+    else
+	safe_strncpy(expires, "-", sizeof(expires));
+
+    if (s->family == AF_INET) {
+	daddr[15] = gaddr[15] = '\0';
+	printf("%-15s %-15s %-5s %5u %7s %s\n",
+	       daddr, gaddr, flags, mtu, expires, ifname);
+    } else
+	printf("%-30s %-26s %-4s %5u %7s %s\n",
+	       daddr, gaddr, flags, mtu, expires, ifname);
+    s->rows++;
+    return 0;
+}
+
+/* Stream the exceptions of one family.  Returns -1 with nothing printed
+   when rtnetlink is not usable, so the caller can try /proc. */
+int route_cache_netlink(int family, int numeric, int options)
+{
+    struct rtnl_handle rth;
+    struct cache_show s;
+    struct rtmsg req;
+    struct timeval start;
+    int rc;
+
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    memset(&req, 0, sizeof(req));
+    req.rtm_family = family;
+    req.rtm_flags = RTM_F_CLONED;
+    if (rtnl_dump_request(&rth, RTM_GETROUTE, &req, sizeof(req)) < 0) {
+	rtnl_close(&rth);
+	return -1;
+    }
+    memset(&s, 0, sizeof(s));
+    s.family = family;
+    s.numeric = numeric;
+    if ((s.hz = sysconf(_SC_CLK_TCK)) <= 0)
+	s.hz = 100;
+
+    if (family == AF_INET)
+	printf(_("Kernel IP routing cache\n"));
+    else
+	printf(_("Kernel IPv6 routing cache\n"));
+    cache_print_head(family);
+    gettimeofday(&start, NULL);
+    rc = rtnl_dump_filter(&rth, cache_show, &s);
+    rtnl_close(&rth);
+    if (rc < 0) {
+	perror("RTM_GETROUTE");
+	return 1;
+    }
+    if (options & FLAG_VERBOSE)
+	fprintf(stderr, _("route: %lu %s exceptions, %lu listed, in %.3fs\n"),
+		s.seen, family == AF_INET ? "IPv4" : "IPv6", s.rows,
+		elapsed(&start));
+    return 0;
+}
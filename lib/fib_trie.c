@@ -0,0 +1,213 @@
+/*
+ * lib/fib_trie.c	A path compressed binary trie over IPv4 and IPv6
+ *			prefixes for longest prefix match lookups done in
+ *			user space.
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		Keys are kept as host order 32 bit words, most significant
+ *		word first, so a bit index is the same for both families.
+ *		Nodes only exist where a prefix ends or two prefixes part,
+ *		which bounds a lookup by the number of prefixes on the path
+ *		rather than by the address length.  Full tables are dense in
+ *		the first 16 bits, so fib_trie_compress() adds a 64k entry
+ *		table that replaces the top of every walk by one index.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "util.h"
+#include "fib.h"
+
+#define KEY_BIT(k, i)	(((k)[(i) >> 5] >> (31 - ((i) & 31))) & 1)
+
+/* First bit in which a and b differ, or limit if they agree that far. */
+static int key_diff(const __u32 *a, const __u32 *b, int limit)
+{
+    int w, d;
+
+    for (w = 0; w * 32 < limit; w++) {
+	__u32 x = a[w] ^ b[w];
+
+	if (x) {
+	    d = w * 32 + __builtin_clz(x);
+	    return d < limit ? d : limit;
+	}
+    }
+    return limit;
+}
+
+static void key_mask(__u32 *dst, const __u32 *key, int plen, int words)
+{
+    int w;
+
+    for (w = 0; w < words; w++, plen -= 32) {
+	if (plen >= 32)
+	    dst[w] = key[w];
+	else if (plen <= 0)
+	    dst[w] = 0;
+	else
+	    dst[w] = key[w] & (~0U << (32 - plen));
+    }
+}
+
+static struct fib_node *node_new(struct fib_trie *t, const __u32 *key, int plen)
+{
+    struct fib_node *n;
+
+    new(n);
+    key_mask(n->key, key, plen, t->bits / 32);
+    n->plen = plen;
+    t->nodes++;
+    return n;
+}
+
+void fib_trie_init(struct fib_trie *t, int bits)
+{
+    memset(t, 0, sizeof(*t));
+    t->bits = bits;
+}
+
+/* Returns the data slot of prefix key/plen, creating the node if needed;
+   a NULL slot means the prefix is new. */
+void **fib_trie_insert(struct fib_trie *t, const __u32 *key, int plen)
+{
+    struct fib_node **pp = &t->root, *n, *leaf, *glue;
+    int d;
+
+    if (t->jump) {
+	free(t->jump);
+	t->jump = NULL;
+    }
+    while ((n = *pp) != NULL) {
+	d = key_diff(n->key, key, n->plen < plen ? n->plen : plen);
+	if (d < n->plen) {
+	    leaf = node_new(t, key, plen);
+	    if (d == plen) {
+		leaf->child[KEY_BIT(n->key, plen)] = n;
+		*pp = leaf;
+		return &leaf->data;
+	    }
+	    glue = node_new(t, key, d);
+	    glue->child[KEY_BIT(n->key, d)] = n;
+	    glue->child[KEY_BIT(key, d)] = leaf;
+	    *pp = glue;
+	    return &leaf->data;
+	}
+	if (n->plen == plen)
+	    return &n->data;
+	pp = &n->child[KEY_BIT(key, n->plen)];
+    }
+    *pp = node_new(t, key, plen);
+    return &(*pp)->data;
+}
+
+/* For every value of the first FIB_JUMP_BITS bits remember where a walk
+   reaches the first node that needs more bits, and the best match above. */
+void fib_trie_compress(struct fib_trie *t)
+{
+    __u32 key[4] = { 0, 0, 0, 0 };
+    struct fib_node *n;
+    void *best;
+    __u32 v;
+
+    if (!t->jump)
+	t->jump = xmalloc(sizeof(*t->jump) << FIB_JUMP_BITS);
+    for (v = 0; v < (1U << FIB_JUMP_BITS); v++) {
+	key[0] = v << (32 - FIB_JUMP_BITS);
+	best = NULL;
+	for (n = t->root; n && n->plen < FIB_JUMP_BITS; n = n->child[KEY_BIT(key, n->plen)]) {
+	    if (key_diff(n->key, key, n->plen) < n->plen) {
+		n = NULL;
+		break;
+	    }
+	    if (n->data)
+		best = n->data;
+	}
+	t->jump[v].node = n;
+	t->jump[v].best = best;
+    }
+}
+
+void *fib_trie_lookup(const struct fib_trie *t, const __u32 *addr)
+{
+    const struct fib_node *n = t->root;
+    void *best = NULL;
+
+    if (t->jump) {
+	n = t->jump[addr[0] >> (32 - FIB_JUMP_BITS)].node;
+	best = t->jump[addr[0] >> (32 - FIB_JUMP_BITS)].best;
+    }
+    while (n) {
+	if (n->plen && key_diff(n->key, addr, n->plen) < n->plen)
+	    break;
+	if (n->data)
+	    best = n->data;
+	if (n->plen == t->bits)
+	    break;
+	n = n->child[KEY_BIT(addr, n->plen)];
+    }
+    return best;
+}
+
+static void node_walk(const struct fib_node *n, void *cover,
+		      void (*fn)(void *, void *, void *), void *arg)
+{
+    for (; n; n = n->child[1]) {
+	if (n->data) {
+	    fn(n->data, cover, arg);
+	    node_walk(n->child[0], n->data, fn, arg);
+	    cover = n->data;
+	} else
+	    node_walk(n->child[0], cover, fn, arg);
+    }
+}
+
+/* Call fn for every prefix, shorter ones first, along with the data of
+   the longest other prefix that covers it (NULL if there is none). */
+void fib_trie_walk(const struct fib_trie *t, void (*fn)(void *data, void *cover, void *arg),
+		   void *arg)
+{
+    node_walk(t->root, NULL, fn, arg);
+}
+
+static void node_free(struct fib_node *n, void (*fn)(void *))
+{
+    if (!n)
+	return;
+    node_free(n->child[0], fn);
+    node_free(n->child[1], fn);
+    if (n->data && fn)
+	fn(n->data);
+    free(n);
+}
+
+void fib_trie_free(struct fib_trie *t, void (*fn)(void *))
+{
+    node_free(t->root, fn);
+    free(t->jump);
+    t->jump = NULL;
+    t->root = NULL;
+    t->nodes = 0;
+}
+
+void fib_key4(__u32 *key, struct in_addr a)
+{
+    key[0] = ntohl(a.s_addr);
+}
+
+void fib_key6(__u32 *key, const struct in6_addr *a)
+{
+    int w;
+
+    for (w = 0; w < 4; w++)
+	key[w] = ntohl(a->s6_addr32[w]);
+}
@@ -0,0 +1,350 @@
+/*
+ * lib/getmcast.c	Read the multicast group memberships of the
+ *			interfaces for netstat -g and ipmaddr.
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		/proc/net/igmp, igmp6 and dev_mcast are parsed once here
+ *		into binary records, so callers need not go through text
+ *		addresses.  /proc has the number of users of each group;
+ *		an RTM_GETMULTICAST dump does not, but can be limited to
+ *		one interface by the kernel.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include "config.h"
+#include "pathnames.h"
+#include "proc.h"
+#include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
+#include "mcast.h"
+
+#ifndef SOL_NETLINK
+#define SOL_NETLINK		270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK	12
+#endif
+#ifndef RTM_NEWMULTICAST
+#define RTM_NEWMULTICAST	56
+#endif
+
+#define MAF_LAST_REPORTER	0x02	/* net/if_inet6.h */
+
+static int mcast_hexval(int c)
+{
+    if (c >= '0' && c <= '9')
+	return c - '0';
+    if (c >= 'a' && c <= 'f')
+	return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+	return c - 'A' + 10;
+    return -1;
+}
+
+static int mcast_hex(const char *s, unsigned char *buf, int max)
+{
+    int len = 0, hi, lo;
+
+    while (len < max && s[0] && s[1]) {
+	if ((hi = mcast_hexval(s[0])) < 0 || (lo = mcast_hexval(s[1])) < 0)
+	    break;
+	buf[len++] = hi << 4 | lo;
+	s += 2;
+    }
+    return len;
+}
+
+/*
+ * Idx	Device    : Count Querier	Group    Users Timer	Reporter
+ * 1	lo        :     1      V3
+ *				010000E0     1 0:00000000		0
+ *
+ * The group is the address in network order printed as one word.
+ */
+static int mcast_read_igmp(int ifindex, mcast_fn fn, void *arg)
+{
+    char line[512], name[IFNAMSIZ], grp[16];
+    struct mcast_entry e;
+    unsigned int addr, timer;
+    int idx = 0, idx_flag, users, running, reporter, rc = 0;
+    FILE *fp = proc_fopen(_PATH_PROCNET_IGMP);
+
+    if (!fp)
+	return -1;
+    /* 2.0 kernels had no Idx column */
+    if (!fgets(line, sizeof(line), fp)) {
+	fclose(fp);
+	return 0;
+    }
+    idx_flag = strncmp(line, "Idx", 3) == 0;
+    name[0] = '\0';
+    while (fgets(line, sizeof(line), fp)) {
+	if (line[0] != '\t') {
+	    if (idx_flag ? sscanf(line, "%d %15[^ :\t]", &idx, name) != 2
+			 : sscanf(line, "%15[^ :\t]", name) != 1)
+		name[0] = '\0';
+	    continue;
+	}
+	if (!name[0] || (ifindex && idx != ifindex))
+	    continue;
+	reporter = 0;
+	if (sscanf(line, " %8[0-9A-Fa-f] %d %d:%x %d",
+		   grp, &users, &running, &timer, &reporter) < 2)
+	    continue;
+	addr = strtoul(grp, NULL, 16);
+	memset(&e, 0, sizeof(e));
+	e.family = AF_INET;
+	e.ifindex = idx;
+	e.users = users;
+	if (reporter)
+	    e.flags |= MCAST_REPORTER;
+	e.alen = 4;
+	memcpy(e.group, &addr, 4);
+	safe_strncpy(e.iface, name, sizeof(e.iface));
+	if ((rc = fn(&e, arg)) < 0)
+	    break;
+    }
+    fclose(fp);
+    return rc;
+}
+
+/* igmp6: index, device, group, users, MAF_* flags, timer.
+   dev_mcast: index, device, users, global use, address. */
+static int mcast_read_lines(int family, int ifindex, mcast_fn fn, void *arg)
+{
+    char line[512], name[IFNAMSIZ], hex[128];
+    struct mcast_entry e;
+    unsigned int flags;
+    int idx, users, num, rc = 0;
+    FILE *fp = proc_fopen(family == AF_INET6 ? _PATH_PROCNET_IGMP6
+					      : _PATH_PROCNET_DEV_MCAST);
+
+    if (!fp)
+	return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	flags = 0;
+	if (family == AF_INET6)
+	    num = sscanf(line, "%d %15s %127s %d %x", &idx, name, hex, &users, &flags);
+	else
+	    num = sscanf(line, "%d %15s %d %u %127s", &idx, name, &users, &flags, hex);
+	if (num < 4 || (ifindex && idx != ifindex))
+	    continue;
+	memset(&e, 0, sizeof(e));
+	e.family = family;
+	e.ifindex = idx;
+	e.users = users;
+	if (family == AF_INET6) {
+	    if (flags & MAF_LAST_REPORTER)
+		e.flags |= MCAST_REPORTER;
+	    if (mcast_hex(hex, e.group, 16) != 16)
+		continue;
+	    e.alen = 16;
+	} else {
+	    if (num < 5)
+		continue;
+	    if (flags)
+		e.flags |= MCAST_STATIC;
+	    e.alen = mcast_hex(hex, e.group, MCAST_ADDR_MAX);
+	}
+	safe_strncpy(e.iface, name, sizeof(e.iface));
+	if ((rc = fn(&e, arg)) < 0)
+	    break;
+    }
+    fclose(fp);
+    return rc;
+}
+
+/* Stream the memberships of one family (AF_PACKET for link layer
+   addresses) in /proc order.  -1 with errno set when the file cannot be
+   opened. */
+int mcast_read_proc(int family, int ifindex, mcast_fn fn, void *arg)
+{
+    switch (family) {
+    case AF_INET:
+	return mcast_read_igmp(ifindex, fn, arg);
+    case AF_INET6:
+    case AF_PACKET:
+	return mcast_read_lines(family, ifindex, fn, arg);
+    }
+    errno = EAFNOSUPPORT;
+    return -1;
+}
+
+struct mcast_dump {
+    int ifindex;
+    mcast_fn fn;
+    void *arg;
+};
+
+static int mcast_dump_one(struct nlmsghdr *n, void *arg)
+{
+    struct mcast_dump *d = arg;
+    struct ifaddrmsg *ifa = NLMSG_DATA(n);
+    struct rtattr *tb[IFA_MAX + 1];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa));
+    struct mcast_entry e;
+
+    /* dumps answer with the request type */
+    if ((n->nlmsg_type != RTM_GETMULTICAST &&
+	 n->nlmsg_type != RTM_NEWMULTICAST) || len < 0)
+	return 0;
+    /* kernels without strict checking ignore the index in the request */
+    if (d->ifindex && (int) ifa->ifa_index != d->ifindex)
+	return 0;
+    memset(&e, 0, sizeof(e));
+    e.alen = ifa->ifa_family == AF_INET ? 4 : 16;
+    parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa), len);
+    if (!tb[IFA_MULTICAST] || RTA_PAYLOAD(tb[IFA_MULTICAST]) < e.alen)
+	return 0;
+
+    e.family = ifa->ifa_family;
+    e.ifindex = ifa->ifa_index;
+    e.users = -1;
+    memcpy(e.group, RTA_DATA(tb[IFA_MULTICAST]), e.alen);
+    safe_strncpy(e.iface, route_ifname(e.ifindex), sizeof(e.iface));
+    return d->fn(&e, d->arg);
+}
+
+/*
+ * RTM_GETMULTICAST dump of AF_INET or AF_INET6, restricted to ifindex by
+ * the kernel when it does strict checking of dump requests.  IPv6 has
+ * had it for long, IPv4 only on recent kernels; -1 with nothing passed
+ * to fn when it is not there, so the caller can read /proc instead.
+ */
+int mcast_read_netlink(int family, int ifindex, mcast_fn fn, void *arg)
+{
+    struct rtnl_handle rth;
+    struct ifaddrmsg req;
+    struct mcast_dump d;
+    int one = 1, rc;
+
+    if (family != AF_INET && family != AF_INET6) {
+	errno = EAFNOSUPPORT;
+	return -1;
+    }
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    setsockopt(rth.fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one, sizeof(one));
+    memset(&req, 0, sizeof(req));
+    req.ifa_family = family;
+    req.ifa_index = ifindex;
+    d.ifindex = ifindex;
+    d.fn = fn;
+    d.arg = arg;
+    if ((rc = rtnl_dump_request(&rth, RTM_GETMULTICAST, &req, sizeof(req))) >= 0)
+	rc = rtnl_dump_filter(&rth, mcast_dump_one, &d);
+    rtnl_close(&rth);
+    return rc;
+}
+
+/* Groups by address, open addressing; joined on many interfaces a group
+   is still one slot. */
+struct mcast_agg {
+    struct mcast_group *grp;
+    int *slot;			/* index into grp + 1, 0 free */
+    int count, size, mask;
+};
+
+static unsigned int mcast_hash(const struct mcast_entry *e)
+{
+    return fnv_hash(FNV_INIT ^ e->family, e->group, e->alen);
+}
+
+static void mcast_agg_grow(struct mcast_agg *a)
+{
+    int i, j;
+
+    a->mask = a->mask ? a->mask * 2 + 1 : 1023;
+    free(a->slot);
+    a->slot = xmalloc((a->mask + 1) * sizeof(*a->slot));
+    memset(a->slot, 0, (a->mask + 1) * sizeof(*a->slot));
+    for (i = 0; i < a->count; i++) {
+	struct mcast_entry e;
+
+	e.family = a->grp[i].family;
+	e.alen = a->grp[i].alen;
+	memcpy(e.group, a->grp[i].group, e.alen);
+	for (j = mcast_hash(&e) & a->mask; a->slot[j]; j = (j + 1) & a->mask)
+	    ;
+	a->slot[j] = i + 1;
+    }
+}
+
+static int mcast_agg_add(struct mcast_entry *e, void *arg)
+{
+    struct mcast_agg *a = arg;
+    struct mcast_group *g;
+    int i;
+
+    if (a->count * 2 >= a->mask)
+	mcast_agg_grow(a);
+    for (i = mcast_hash(e) & a->mask; a->slot[i]; i = (i + 1) & a->mask) {
+	g = &a->grp[a->slot[i] - 1];
+	if (g->family == e->family && g->alen == e->alen &&
+	    !memcmp(g->group, e->group, e->alen))
+	    goto found;
+    }
+    if (a->count == a->size) {
+	a->size = a->size ? a->size * 2 : 256;
+	a->grp = xrealloc(a->grp, a->size * sizeof(*a->grp));
+    }
+    g = &a->grp[a->count++];
+    memset(g, 0, sizeof(*g));
+    g->family = e->family;
+    g->alen = e->alen;
+    memcpy(g->group, e->group, e->alen);
+    a->slot[i] = a->count;
+found:
+    g->ifaces++;
+    if (e->users > 0)
+	g->users += e->users;
+    return 0;
+}
+
+static int mcast_groupcmp(const void *a, const void *b)
+{
+    const struct mcast_group *x = a, *y = b;
+
+    if (x->family != y->family)
+	return x->family < y->family ? -1 : 1;
+    return memcmp(x->group, y->group, x->alen);
+}
+
+/* The groups of AF_INET, AF_INET6 or both (AF_UNSPEC) from /proc, sorted
+   by family and address.  NULL when nothing could be read. */
+struct mcast_group *mcast_groups(int family, int *count)
+{
+    struct mcast_agg a;
+    int ok = 0;
+
+    memset(&a, 0, sizeof(a));
+    if (family == AF_UNSPEC || family == AF_INET)
+	ok |= mcast_read_proc(AF_INET, 0, mcast_agg_add, &a) >= 0;
+    if (family == AF_UNSPEC || family == AF_INET6)
+	ok |= mcast_read_proc(AF_INET6, 0, mcast_agg_add, &a) >= 0;
+    free(a.slot);
+    *count = a.count;
+    if (!ok) {
+	free(a.grp);
+	return NULL;
+    }
+    if (!a.grp)
+	a.grp = xmalloc(sizeof(*a.grp));
+    qsort(a.grp, a.count, sizeof(*a.grp), mcast_groupcmp);
+    return a.grp;
+}
@@ -0,0 +1,272 @@
+/*
+ * lib/getneigh.c	Read the kernel neighbour tables (ARP and IPv6
+ *			neighbour discovery) for arp.
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		/proc/net/arp only has IPv4 and no NUD state.  An
+ *		RTM_GETNEIGH dump has both families, the state, the
+ *		timers and the router flag, and is streamed to the caller
+ *		one entry at a time, so large tables cost no memory.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/if_arp.h>
+#include <linux/neighbour.h>
+#include "config.h"
+#include "pathnames.h"
+#include "util.h"
+#include "libnetlink.h"
+#include "neigh.h"
+
+#ifndef NUD_VALID
+#define NUD_VALID	(NUD_PERMANENT | NUD_NOARP | NUD_REACHABLE | \
+			 NUD_PROBE | NUD_STALE | NUD_DELAY)
+#endif
+#ifndef NDA_RTA
+#define NDA_RTA(r)	((struct rtattr *) (((char *) (r)) + \
+			 NLMSG_ALIGN(sizeof(struct ndmsg))))
+#endif
+
+/* Neighbour messages carry interface indexes and /proc has names; both
+   need the hardware type of the device.  Few interfaces serve many
+   neighbours, so a small direct mapped cache saves two ioctls per row. */
+const char *neigh_link(int ifindex, int *hwtype)
+{
+    static struct {
+	int index;
+	int type;
+	char name[IFNAMSIZ];
+    } cache[64];
+    static int fd = -1;
+    int slot = ifindex & 63;
+    struct ifreq ifr;
+
+    if (ifindex <= 0) {
+	*hwtype = 0;
+	return "*";
+    }
+    if (cache[slot].index != ifindex) {
+	cache[slot].index = ifindex;
+	cache[slot].type = 0;
+	if (!if_indextoname(ifindex, cache[slot].name))
+	    snprintf(cache[slot].name, IFNAMSIZ, "if%d", ifindex);
+	else {
+	    if (fd < 0)
+		fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	    memset(&ifr, 0, sizeof(ifr));
+	    safe_strncpy(ifr.ifr_name, cache[slot].name, IFNAMSIZ);
+	    if (fd >= 0 && ioctl(fd, SIOCGIFHWADDR, &ifr) == 0)
+		cache[slot].type = ifr.ifr_hwaddr.sa_family;
+	}
+    }
+    *hwtype = cache[slot].type;
+    return cache[slot].name;
+}
+
+/* The flags /proc/net/arp shows for an entry in this state. */
+static int neigh_flags(unsigned int state, unsigned int ntf)
+{
+    if (ntf & NTF_PROXY)
+	return ATF_PUBL | ATF_PERM;
+    if (state & NUD_PERMANENT)
+	return ATF_PERM | ATF_COM;
+    if (state & NUD_VALID)
+	return ATF_COM;
+    return 0;
+}
+
+/* Fill e from an RTM_NEWNEIGH or RTM_DELNEIGH message; -1 for anything
+   else. */
+int neigh_parse(struct nlmsghdr *n, struct neigh_entry *e)
+{
+    static long hz;
+    struct ndmsg *r = NLMSG_DATA(n);
+    struct rtattr *tb[NDA_MAX + 1];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+    int alen;
+
+    if ((n->nlmsg_type != RTM_NEWNEIGH && n->nlmsg_type != RTM_DELNEIGH) || len < 0)
+	return -1;
+    if (r->ndm_family == AF_INET)
+	alen = 4;
+    else if (r->ndm_family == AF_INET6)
+	alen = 16;
+    else
+	return -1;
+    parse_rtattr(tb, NDA_MAX, NDA_RTA(r), len);
+    if (!tb[NDA_DST] || RTA_PAYLOAD(tb[NDA_DST]) < alen)
+	return -1;
+
+    memset(e, 0, sizeof(*e));
+    e->family = r->ndm_family;
+    memcpy(e->addr, RTA_DATA(tb[NDA_DST]), alen);
+    if (tb[NDA_LLADDR]) {
+	e->lladdr_len = RTA_PAYLOAD(tb[NDA_LLADDR]);
+	if (e->lladdr_len > NEIGH_LLADDR_MAX)
+	    e->lladdr_len = NEIGH_LLADDR_MAX;
+	memcpy(e->lladdr, RTA_DATA(tb[NDA_LLADDR]), e->lladdr_len);
+    } else if (r->ndm_flags & NTF_PROXY)
+	e->lladdr_len = 6;
+    e->state = r->ndm_state;
+    e->ntf = r->ndm_flags;
+    e->flags = neigh_flags(e->state, e->ntf);
+    e->ifindex = r->ndm_ifindex;
+    safe_strncpy(e->iface, neigh_link(e->ifindex, &e->hwtype), sizeof(e->iface));
+
+    e->probes = tb[NDA_PROBES] ? (int) RTA_U32(tb[NDA_PROBES]) : -1;
+    e->used = e->confirmed = e->updated = -1;
+    if (tb[NDA_CACHEINFO]) {
+	struct nda_cacheinfo *ci = RTA_DATA(tb[NDA_CACHEINFO]);
+
+	if (!hz && (hz = sysconf(_SC_CLK_TCK)) <= 0)
+	    hz = 100;
+	e->used = ci->ndm_used / hz;
+	e->confirmed = ci->ndm_confirmed / hz;
+	e->updated = ci->ndm_updated / hz;
+    }
+    return 0;
+}
+
+struct neigh_dump {
+    neigh_fn fn;
+    void *arg;
+};
+
+static int neigh_dump_one(struct nlmsghdr *n, void *arg)
+{
+    struct neigh_dump *d = arg;
+    struct neigh_entry e;
+
+    if (neigh_parse(n, &e) < 0)
+	return 0;
+    return d->fn(&e, d->arg);
+}
+
+static int neigh_dump(struct rtnl_handle *rth, int family, int flags,
+		      struct neigh_dump *d)
+{
+    struct ndmsg req;
+
+    memset(&req, 0, sizeof(req));
+    req.ndm_family = family;
+    req.ndm_flags = flags;
+    if (rtnl_dump_request(rth, RTM_GETNEIGH, &req, sizeof(req)) < 0)
+	return -1;
+    return rtnl_dump_filter(rth, neigh_dump_one, d);
+}
+
+/* Stream the neighbours of a family (AF_UNSPEC for both), then the proxy
+   entries.  Returns -1 with nothing passed to fn when rtnetlink is not
+   usable, so the caller can fall back to /proc. */
+int neigh_read_netlink(int family, neigh_fn fn, void *arg)
+{
+    struct rtnl_handle rth;
+    struct neigh_dump d;
+    int rc;
+
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    d.fn = fn;
+    d.arg = arg;
+    if ((rc = neigh_dump(&rth, family, 0, &d)) == 0)
+	rc = neigh_dump(&rth, family, NTF_PROXY, &d);
+    rtnl_close(&rth);
+    return rc;
+}
+
+static int neigh_hex(const char *s, unsigned char *buf, int max)
+{
+    unsigned int b;
+    int len = 0;
+
+    while (len < max && sscanf(s, "%2x", &b) == 1) {
+	buf[len++] = b;
+	if (!(s = strchr(s, ':')))
+	    break;
+	s++;
+    }
+    return len;
+}
+
+/* /proc/net/arp: IPv4 only, and the flags stand in for the state. */
+int neigh_read_proc(neigh_fn fn, void *arg)
+{
+    char line[512], ip[100], hwa[100], mask[100], dev[100];
+    struct neigh_entry e;
+    struct in_addr a;
+    int num, type, flags, rc = 0;
+    FILE *fp = fopen(_PATH_PROCNET_ARP, "r");
+
+    if (!fp)
+	return -1;
+    /* Bypass header -- read until newline */
+    if (!fgets(line, sizeof(line), fp)) {
+	fclose(fp);
+	return 0;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+	num = sscanf(line, "%99s 0x%x 0x%x %99s %99s %99s",
+		     ip, &type, &flags, hwa, mask, dev);
+	if (num < 4 || inet_pton(AF_INET, ip, &a) != 1)
+	    continue;
+	memset(&e, 0, sizeof(e));
+	e.family = AF_INET;
+	memcpy(e.addr, &a, 4);
+	e.hwtype = type;
+	e.flags = flags;
+	e.lladdr_len = neigh_hex(hwa, e.lladdr, sizeof(e.lladdr));
+	if (flags & ATF_PUBL)
+	    e.ntf = NTF_PROXY;
+	safe_strncpy(e.iface, num < 6 ? "-" : dev, sizeof(e.iface));
+	e.probes = -1;
+	e.used = e.confirmed = e.updated = -1;
+	if ((rc = fn(&e, arg)) < 0)
+	    break;
+    }
+    fclose(fp);
+    return rc;
+}
+
+const char *neigh_state_name(unsigned int state)
+{
+    static const char *names[] = {
+	"INCOMPLETE", "REACHABLE", "STALE", "DELAY",
+	"PROBE", "FAILED", "NOARP", "PERMANENT"
+    };
+    int i;
+
+    for (i = 0; i < 8; i++)
+	if (state & (1 << i))
+	    return names[i];
+    return "NONE";
+}
+
+/* Link layer addresses the way /proc/net/arp shows them. */
+char *neigh_lladdr(const struct neigh_entry *e, char *buf, int len)
+{
+    static const char hex[] = "0123456789abcdef";
+    int i, n = 0;
+
+    for (i = 0; i < e->lladdr_len && n + 3 < len; i++) {
+	if (i)
+	    buf[n++] = ':';
+	buf[n++] = hex[e->lladdr[i] >> 4];
+	buf[n++] = hex[e->lladdr[i] & 15];
+    }
+    buf[n] = '\0';
+    return buf;
+}
@@ -30,13 +30,19 @@
  *              your option) any later version.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/rtnetlink.h>
 #include "net-support.h"
 #include "pathnames.h"
 #include "version.h"
 #include "config.h"
 #include "intl.h"
 #include "util.h"
+#include "fib.h"
 
 extern struct aftype unspec_aftype;
 extern struct aftype unix_aftype;
@@ -115,3 +121,388 @@ int route_info(const char *afname, int options)
     }
     return (found);
 }
+
+
+int route_table = FIB_TABLE_PROC;
+
+static struct {
+    int table;
+    const char *name;
+} rt_table_names[] = {
+    { RT_TABLE_UNSPEC,	"all" },
+    { RT_TABLE_DEFAULT,	"default" },
+    { RT_TABLE_MAIN,	"main" },
+    { RT_TABLE_LOCAL,	"local" },
+};
+
+/* Look a table up by number, by one of the well known names or in
+   /etc/iproute2/rt_tables the way ip(8) does. */
+int route_parse_table(const char *name, int *table)
+{
+    char buf[256], id[64], *end;
+    unsigned long t;
+    FILE *fp;
+    int i;
+
+    for (i = 0; i < sizeof(rt_table_names) / sizeof(rt_table_names[0]); i++)
+	if (!strcmp(name, rt_table_names[i].name)) {
+	    *table = rt_table_names[i].table;
+	    return 0;
+	}
+    t = strtoul(name, &end, 0);
+    if (*name && !*end) {
+	*table = t;
+	return 0;
+    }
+    if ((fp = fopen(_PATH_RT_TABLES, "r")) == NULL)
+	return -1;
+    while (fgets(buf, sizeof(buf), fp)) {
+	char tname[64];
+
+	if (sscanf(buf, "%63s %63s", id, tname) != 2 || id[0] == '#')
+	    continue;
+	if (strcmp(tname, name))
+	    continue;
+	t = strtoul(id, &end, 0);
+	if (*end)
+	    continue;
+	fclose(fp);
+	*table = t;
+	return 0;
+    }
+    fclose(fp);
+    return -1;
+}
+
+const char *route_table_name(int table)
+{
+    static char buf[32];
+    int i;
+
+    for (i = 0; i < sizeof(rt_table_names) / sizeof(rt_table_names[0]); i++)
+	if (rt_table_names[i].table == table)
+	    return rt_table_names[i].name;
+    snprintf(buf, sizeof(buf), "%u", table);
+    return buf;
+}
+
+/* address[/plen] of either family; a missing length means the host. */
+int route_parse_prefix(const char *arg, struct route_prefix *p)
+{
+    char buf[64], *slash, *end;
+    long plen;
+
+    safe_strncpy(buf, arg, sizeof(buf));
+    memset(p, 0, sizeof(*p));
+    if ((slash = strchr(buf, '/')))
+	*slash++ = '\0';
+    if (inet_pton(AF_INET, buf, p->addr) > 0) {
+	p->family = AF_INET;
+	p->plen = 32;
+    } else if (inet_pton(AF_INET6, buf, p->addr) > 0) {
+	p->family = AF_INET6;
+	p->plen = 128;
+    } else
+	return -1;
+    if (slash) {
+	plen = strtol(slash, &end, 10);
+	if (!*slash || *end || plen < 0 || plen > p->plen)
+	    return -1;
+	p->plen = plen;
+    }
+    return 0;
+}
+
+int route_prefix_match(const struct route_prefix *p, int family, const void *addr)
+{
+    const unsigned char *a = addr;
+    int bytes = p->plen / 8, bits = p->plen % 8;
+
+    if (p->family == AF_UNSPEC)
+	return 1;
+    if (p->family != family || memcmp(a, p->addr, bytes))
+	return 0;
+    return !bits || !((a[bytes] ^ p->addr[bytes]) & (0xff00 >> bits));
+}
+
+/* Route files name the same few devices over and over. */
+int route_ifindex(const char *name)
+{
+    static char last[IFNAMSIZ];
+    static int index;
+
+    if (strncmp(name, last, IFNAMSIZ)) {
+	index = if_nametoindex(name);
+	safe_strncpy(last, name, sizeof(last));
+    }
+    return index;
+}
+
+/* Netlink routes carry interface indexes.  Tables have many routes over
+   few interfaces, so a small direct mapped cache saves an ioctl per row. */
+const char *route_ifname(int ifindex)
+{
+    static struct {
+	int index;
+	char name[IFNAMSIZ];
+    } cache[64];
+    int slot = ifindex & 63;
+
+    if (ifindex <= 0)
+	return "*";
+    if (cache[slot].index != ifindex) {
+	if (!if_indextoname(ifindex, cache[slot].name))
+	    snprintf(cache[slot].name, IFNAMSIZ, "if%d", ifindex);
+	cache[slot].index = ifindex;
+    }
+    return cache[slot].name;
+}
+
+
+/* route lookup: load a FIB once into a prefix trie per family and answer
+   longest prefix matches for a list of addresses without the kernel. */
+struct lookup_ctx {
+    int options;
+    int ext, numeric;
+    unsigned long routes;
+    double load;
+#if HAVE_AFINET
+    int loaded4;
+    struct fib_trie t4;
+#endif
+#if HAVE_AFINET6
+    int loaded6;
+    struct fib_trie t6;
+#endif
+};
+
+/* Trie data: a route and its columns, formatted when first matched.
+   Lookups concentrate on few routes, so most rows are printed from here. */
+struct lookup_route {
+    char *row;
+    union {
+	struct fib4_entry e4;
+	struct fib6_entry e6;
+    } u;
+};
+
+static void lookup_free(void *p)
+{
+    free(((struct lookup_route *) p)->row);
+    free(p);
+}
+
+static const char *lookup_row(struct lookup_ctx *c, struct lookup_route *r, int v6)
+{
+    char buf[512];
+    FILE *fp;
+
+    if (r->row)
+	return r->row;
+    buf[0] = '\0';
+    if ((fp = fmemopen(buf, sizeof(buf), "w")) != NULL) {
+	if (v6)
+	    fib6_print(fp, &r->u.e6, c->numeric);
+	else
+	    fib4_print(fp, &r->u.e4, c->ext, c->numeric);
+	fclose(fp);
+    }
+    return r->row = xstrdup(buf);
+}
+
+static int lookup_table(int options)
+{
+    if (route_table == FIB_TABLE_PROC || (options & FLAG_PROC))
+	return RT_TABLE_MAIN;
+    return route_table;
+}
+
+#if HAVE_AFINET
+static int lookup_add4(struct fib4_entry *e, void *arg)
+{
+    struct lookup_ctx *c = arg;
+    struct lookup_route *old;
+    __u32 key[4];
+    void **slot;
+
+    fib_key4(key, e->dst);
+    slot = fib_trie_insert(&c->t4, key, e->dst_len);
+    /* a prefix listed twice counts once, with its lowest metric */
+    if ((old = *slot) == NULL) {
+	*slot = old = xmalloc(sizeof(*old));
+	c->routes++;
+    } else if (old->u.e4.metric <= e->metric)
+	return 0;
+    old->u.e4 = *e;
+    return 0;
+}
+
+static int lookup_load4(struct lookup_ctx *c)
+{
+    struct timeval start;
+    int table = lookup_table(c->options);
+
+    gettimeofday(&start, NULL);
+    fib_trie_init(&c->t4, 32);
+    c->routes = 0;
+    if ((c->options & FLAG_PROC) ||
+	fib4_read_netlink(table, lookup_add4, c) < 0) {
+	if (c->routes || table != RT_TABLE_MAIN ||
+	    fib4_read_proc(lookup_add4, c) < 0) {
+	    perror(_("route: cannot read the IPv4 routing table"));
+	    return -1;
+	}
+    }
+    fib_trie_compress(&c->t4);
+    if (c->options & FLAG_VERBOSE)
+	fprintf(stderr, _("route: %lu IPv4 prefixes, %lu trie nodes, loaded in %.3fs\n"),
+		c->routes, c->t4.nodes, elapsed(&start));
+    c->load += elapsed(&start);
+    printf("%-15s ", _("Address"));
+    fib4_print_head(c->ext);
+    c->loaded4 = 1;
+    return 0;
+}
+#endif
+
+#if HAVE_AFINET6
+static int lookup_add6(struct fib6_entry *e, void *arg)
+{
+    struct lookup_ctx *c = arg;
+    struct lookup_route *old;
+    __u32 key[4];
+    void **slot;
+
+    if (e->flags & RTF_CACHE)
+	return 0;
+    fib_key6(key, &e->dst);
+    slot = fib_trie_insert(&c->t6, key, e->dst_len);
+    /* a prefix listed twice counts once, with its lowest metric */
+    if ((old = *slot) == NULL) {
+	*slot = old = xmalloc(sizeof(*old));
+	c->routes++;
+    } else if (old->u.e6.metric <= e->metric)
+	return 0;
+    old->u.e6 = *e;
+    return 0;
+}
+
+static int lookup_load6(struct lookup_ctx *c)
+{
+    struct timeval start;
+    int table = lookup_table(c->options);
+
+    gettimeofday(&start, NULL);
+    fib_trie_init(&c->t6, 128);
+    c->routes = 0;
+    if ((c->options & FLAG_PROC) ||
+	fib6_read_netlink(table, lookup_add6, c) < 0) {
+	if (c->routes || table != RT_TABLE_MAIN ||
+	    fib6_read_proc(lookup_add6, c) < 0) {
+	    perror(_("route: cannot read the IPv6 routing table"));
+	    return -1;
+	}
+    }
+    fib_trie_compress(&c->t6);
+    if (c->options & FLAG_VERBOSE)
+	fprintf(stderr, _("route: %lu IPv6 prefixes, %lu trie nodes, loaded in %.3fs\n"),
+		c->routes, c->t6.nodes, elapsed(&start));
+    c->load += elapsed(&start);
+    printf("%-39s ", _("Address"));
+    fib6_print_head();
+    c->loaded6 = 1;
+    return 0;
+}
+#endif
+
+static int lookup_one(struct lookup_ctx *c, const char *addr)
+{
+    __u32 key[4];
+#if HAVE_AFINET
+    struct in_addr in;
+
+    if (inet_pton(AF_INET, addr, &in) > 0) {
+	struct lookup_route *r;
+
+	if (!c->loaded4 && lookup_load4(c) < 0)
+	    return -1;
+	fib_key4(key, in);
+	if ((r = fib_trie_lookup(&c->t4, key)) == NULL) {
+	    printf(_("%-15s no route\n"), addr);
+	    return 1;
+	}
+	printf("%-15s %s", addr, lookup_row(c, r, 0));
+	return 0;
+    }
+#endif
+#if HAVE_AFINET6
+    {
+	struct in6_addr in6;
+
+	if (inet_pton(AF_INET6, addr, &in6) > 0) {
+	    struct lookup_route *r;
+
+	    if (!c->loaded6 && lookup_load6(c) < 0)
+		return -1;
+	    fib_key6(key, &in6);
+	    if ((r = fib_trie_lookup(&c->t6, key)) == NULL) {
+		printf(_("%-39s no route\n"), addr);
+		return 1;
+	    }
+	    printf("%-39s %s", addr, lookup_row(c, r, 1));
+	    return 0;
+	}
+    }
+#endif
+    fprintf(stderr, _("route: `%s' is not an address\n"), addr);
+    return 1;
+}
+
+/* Addresses are read from file (stdin for NULL or "-"), any number per
+   line, '#' starts a comment.  Returns E_LOOKUP if any had no route. */
+int route_lookup(int options, const char *file)
+{
+    struct lookup_ctx c;
+    struct timeval start;
+    unsigned long count = 0;
+    char buf[1024], *tok;
+    int rc = 0, i;
+    FILE *fp = stdin;
+
+    if (file && strcmp(file, "-") && (fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	return E_LOOKUP;
+    }
+    memset(&c, 0, sizeof(c));
+    c.options = options;
+    c.ext = options & FLAG_EXT;
+    c.numeric = options & (FLAG_NUM_HOST | FLAG_SYM);
+
+    gettimeofday(&start, NULL);
+    while (fgets(buf, sizeof(buf), fp)) {
+	for (tok = strtok(buf, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+	    if (*tok == '#')
+		break;
+	    if ((i = lookup_one(&c, tok)) < 0) {
+		rc = E_LOOKUP;
+		goto out;
+	    }
+	    if (i)
+		rc = E_LOOKUP;
+	    count++;
+	}
+    }
+    if (options & FLAG_VERBOSE)
+	fprintf(stderr, _("route: %lu lookups in %.3fs\n"), count,
+		elapsed(&start) - c.load);
+  out:
+    if (fp != stdin)
+	fclose(fp);
+#if HAVE_AFINET
+    fib_trie_free(&c.t4, lookup_free);
+#endif
+#if HAVE_AFINET6
+    fib_trie_free(&c.t6, lookup_free);
+#endif
+    return rc;
+}
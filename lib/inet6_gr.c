@@ -32,6 +32,8 @@
 #include "intl.h"
 #include "net-features.h"
 #include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
 
 /* neighbour discovery from linux-2.4.0/include/net/neighbour.h */
 
@@ -46,8 +48,10 @@
 #define NUD_PERMANENT   0x80
 #define NUD_NONE        0x00
 
+#ifndef NTF_PROXY
 #define NTF_PROXY       0x08    /* == ATF_PUBL */
 #define NTF_ROUTER      0x80
+#endif
 #define NTF_02          0x02  /* waiting for answer of Alexey -eckes */
 #define NTF_04          0x04  /* waiting for answer of Alexey -eckes */
 
@@ -57,68 +61,319 @@
 extern struct aftype inet6_aftype;
 
 
-int rprint_fib6(int ext, int numeric)
+/* /proc/net/ipv6_route re-walks the fib on every read(), and stdio would
+   read it in st_blksize (1k) pieces, so give it a buffer of its own. */
+#define PROC6_BUFSIZE	65536
+
+static const signed char hexval[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+/* Decode n hex digits at p into the buffer at out, two digits a byte.
+   Returns the character after them, or NULL if one is not a hex digit. */
+static const char *hex_decode(const char *p, unsigned char *out, int n)
 {
-    char buff[4096], iface[16], flags[16];
-    char addr6[128], naddr6[128];
-    struct sockaddr_in6 saddr6, snaddr6;
-    int num, iflags, metric, refcnt, use, prefix_len, slen;
+    int hi, lo;
+
+    for (; n > 0; n -= 2) {
+	hi = hexval[(unsigned char) *p++] - 1;
+	lo = hexval[(unsigned char) *p++] - 1;
+	if (hi < 0 || lo < 0)
+	    return NULL;
+	*out++ = hi << 4 | lo;
+    }
+    return p;
+}
+
+/* Decode one blank terminated hex field of at most 8 digits. */
+static const char *hex_field(const char *p, unsigned int *val)
+{
+    unsigned int v = 0;
+    int d, i;
+
+    while (*p == ' ')
+	p++;
+    for (i = 0; i < 8 && (d = hexval[(unsigned char) *p] - 1) >= 0; i++, p++)
+	v = v << 4 | d;
+    if (!i || (*p != ' ' && *p != '\n' && *p != '\0'))
+	return NULL;
+    *val = v;
+    return p;
+}
+
+static const char *in6_field(const char *p, struct in6_addr *a)
+{
+    while (*p == ' ')
+	p++;
+    return hex_decode(p, a->s6_addr, 32);
+}
+
+/* Format a in the style of inet_ntop(), with v4-mapped addresses shown
+   the way fix_v4_address() shows them, without the generic conversion. */
+static char *fib6_ntop(const struct in6_addr *a, char *buf)
+{
+    static const char hex[] = "0123456789abcdef";
+    unsigned int w[8];
+    int i, base = -1, len = 0, b = -1, l = 0;
+    char *p = buf;
+
+    for (i = 0; i < 8; i++)
+	w[i] = a->s6_addr[2 * i] << 8 | a->s6_addr[2 * i + 1];
+    for (i = 0; i < 8; i++) {
+	if (w[i] == 0) {
+	    if (b < 0)
+		b = i, l = 0;
+	    if (++l > len)
+		base = b, len = l;
+	} else
+	    b = -1;
+    }
+    if (len < 2)
+	base = -1;
+    if (base == 0 && len == 5 && w[5] == 0xffff) {
+	sprintf(buf, "%u.%u.%u.%u", a->s6_addr[12], a->s6_addr[13],
+		a->s6_addr[14], a->s6_addr[15]);
+	return buf;
+    }
+    for (i = 0; i < 8; i++) {
+	if (i == base) {
+	    *p++ = ':';
+	    if (i + len == 8)
+		*p++ = ':';
+	    i += len - 1;
+	    continue;
+	}
+	if (i)
+	    *p++ = ':';
+	if (i == 6 && base == 0 && len == 6) {
+	    p += sprintf(p, "%u.%u.%u.%u", a->s6_addr[12], a->s6_addr[13],
+			 a->s6_addr[14], a->s6_addr[15]);
+	    return buf;
+	}
+	if (w[i] >= 0x1000)
+	    *p++ = hex[w[i] >> 12];
+	if (w[i] >= 0x100)
+	    *p++ = hex[(w[i] >> 8) & 15];
+	if (w[i] >= 0x10)
+	    *p++ = hex[(w[i] >> 4) & 15];
+	*p++ = hex[w[i] & 15];
+    }
+    *p = '\0';
+    return buf;
+}
+
+/* Like inet6_aftype.sprint(), but without the text round trip when the
+   address is printed numerically. */
+static const char *fib6_sprint(const struct in6_addr *a, int numeric, char *buf)
+{
+    struct sockaddr_in6 sin6;
+
+    if (numeric & 0x7FFF)
+	return fib6_ntop(a, buf);
+    memset(&sin6, 0, sizeof(sin6));
+    sin6.sin6_family = AF_INET6;
+    sin6.sin6_addr = *a;
+    return inet6_aftype.sprint((struct sockaddr *) &sin6, numeric);
+}
+
+int fib6_read_proc(fib6_fn fn, void *arg)
+{
+    char buff[4096];
+    struct fib6_entry e;
+    unsigned int dst_len, src_len, refcnt, use;
+    const char *p;
+    char *vbuf;
+    int i, rc = 0;
     FILE *fp = fopen(_PATH_PROCNET_ROUTE6, "r");
 
-    char addr6p[8][5], saddr6p[8][5], naddr6p[8][5];
+    if (!fp)
+	return -1;
+    vbuf = xmalloc(PROC6_BUFSIZE);
+    setvbuf(fp, vbuf, _IOFBF, PROC6_BUFSIZE);
+
+    while (fgets(buff, sizeof(buff), fp)) {
+	memset(&e, 0, sizeof(e));
+	if (!(p = in6_field(buff, &e.dst)) ||
+	    !(p = hex_field(p, &dst_len)) ||
+	    !(p = in6_field(p, &e.src)) ||
+	    !(p = hex_field(p, &src_len)) ||
+	    !(p = in6_field(p, &e.gw)) ||
+	    !(p = hex_field(p, &e.metric)) ||
+	    !(p = hex_field(p, &refcnt)) ||
+	    !(p = hex_field(p, &use)) ||
+	    !(p = hex_field(p, &e.flags)))
+	    continue;
+	while (*p == ' ')
+	    p++;
+	for (i = 0; i < IFNAMSIZ - 1 && *p > ' '; i++)
+	    e.iface[i] = *p++;
+	e.dst_len = dst_len;
+	e.src_len = src_len;
+	e.refcnt = refcnt;
+	e.use = use;
+	e.type = (e.flags & RTF_REJECT) ? RTN_UNREACHABLE : RTN_UNICAST;
+
+	if ((rc = fn(&e, arg)) < 0)
+	    break;
+    }
 
-    if (!fp) {
-	perror(_PATH_PROCNET_ROUTE6);
-        printf(_("INET6 (IPv6) not configured in this system.\n"));
-	return 1;
+    (void) fclose(fp);
+    free(vbuf);
+    return rc < 0 ? rc : 0;
+}
+
+/* Fill e from hop nh of one RTM_NEWROUTE/RTM_DELROUTE message, deriving
+   the RTF_* flags /proc/net/ipv6_route would show.  Returns the number of
+   hops in the message (one per /proc row), 0 if it is not an IPv6 route. */
+int fib6_parse(struct nlmsghdr *n, struct fib6_entry *e, int nh)
+{
+    struct rtmsg *r = NLMSG_DATA(n);
+    struct rtattr *tb[RTA_MAX + 1];
+    struct rtattr *gw;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+    int hops = 1, ifindex = 0;
+
+    if (len < 0 || r->rtm_family != AF_INET6)
+	return 0;
+    parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+
+    memset(e, 0, sizeof(*e));
+    e->table = tb[RTA_TABLE] ? RTA_U32(tb[RTA_TABLE]) : r->rtm_table;
+    e->type = r->rtm_type;
+    e->protocol = r->rtm_protocol;
+    e->dst_len = r->rtm_dst_len;
+    e->src_len = r->rtm_src_len;
+    if (tb[RTA_DST])
+	memcpy(&e->dst, RTA_DATA(tb[RTA_DST]), 16);
+    if (tb[RTA_SRC])
+	memcpy(&e->src, RTA_DATA(tb[RTA_SRC]), 16);
+    if (tb[RTA_PRIORITY])
+	e->metric = RTA_U32(tb[RTA_PRIORITY]);
+
+    gw = tb[RTA_GATEWAY];
+    if (tb[RTA_OIF])
+	ifindex = RTA_U32(tb[RTA_OIF]);
+    /* /proc/net/ipv6_route shows RTF_UP on dead (link down) routes too */
+    e->flags = RTF_UP;
+    if (tb[RTA_MULTIPATH]) {
+	struct rtnexthop *rtnh = RTA_DATA(tb[RTA_MULTIPATH]);
+	int mlen = RTA_PAYLOAD(tb[RTA_MULTIPATH]);
+	int i;
+
+	for (hops = 0; RTNH_OK(rtnh, mlen); hops++) {
+	    if (hops == nh) {
+		struct rtattr *nt[RTA_MAX + 1];
+
+		parse_rtattr(nt, RTA_MAX, RTNH_DATA(rtnh),
+			     rtnh->rtnh_len - sizeof(*rtnh));
+		gw = nt[RTA_GATEWAY];
+		ifindex = rtnh->rtnh_ifindex;
+	    }
+	    i = RTNH_ALIGN(rtnh->rtnh_len);
+	    mlen -= i;
+	    rtnh = (struct rtnexthop *) ((char *) rtnh + i);
+	}
+	if (!hops)
+	    hops = 1;
     }
+    safe_strncpy(e->iface, route_ifname(ifindex), sizeof(e->iface));
 
-    if (numeric & RTF_CACHE)
-    	printf(_("Kernel IPv6 routing cache\n"));
-    else
-    	printf(_("Kernel IPv6 routing table\n"));
+    if (gw) {
+	memcpy(&e->gw, RTA_DATA(gw), 16);
+	e->flags |= RTF_GATEWAY;
+    }
+    switch (r->rtm_type) {
+    case RTN_UNREACHABLE:
+    case RTN_PROHIBIT:
+    case RTN_BLACKHOLE:
+    case RTN_THROW:
+	e->flags |= RTF_REJECT | RTF_NONEXTHOP;
+	break;
+    case RTN_LOCAL:
+    case RTN_ANYCAST:
+	e->flags |= RTF_LOCAL | RTF_NONEXTHOP;
+	break;
+    }
+    if (r->rtm_protocol == RTPROT_RA) {
+	e->flags |= RTF_ADDRCONF;
+	if (!r->rtm_dst_len)
+	    e->flags |= RTF_DEFAULT;
+    }
+    if (tb[RTA_EXPIRES] ||
+	(tb[RTA_CACHEINFO] &&
+	 ((struct rta_cacheinfo *) RTA_DATA(tb[RTA_CACHEINFO]))->rta_expires))
+	e->flags |= RTF_EXPIRES;
+    if (r->rtm_flags & RTM_F_CLONED)
+	e->flags |= RTF_CACHE;
+    return hops;
+}
+
+struct fib6_dump {
+    int table;
+    fib6_fn fn;
+    void *arg;
+};
+
+static int fib6_dump_one(struct nlmsghdr *n, void *arg)
+{
+    struct fib6_dump *d = arg;
+    struct fib6_entry e;
+    int hops, i, rc;
+
+    if (n->nlmsg_type != RTM_NEWROUTE)
+	return 0;
+    for (i = 0, hops = 1; i < hops; i++) {
+	if (!(hops = fib6_parse(n, &e, i)))
+	    return 0;
+	if (d->table != RT_TABLE_UNSPEC && e.table != d->table)
+	    return 0;
+	if ((rc = d->fn(&e, d->arg)) < 0)
+	    return rc;
+    }
+    return 0;
+}
+
+/* Stream every IPv6 route of a table (RT_TABLE_UNSPEC for all of them)
+   to fn, one call per next hop.  Returns -1 with nothing passed to fn
+   when rtnetlink is not usable. */
+int fib6_read_netlink(int table, fib6_fn fn, void *arg)
+{
+    struct rtnl_handle rth;
+    struct fib6_dump d;
+    int rc;
+
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    if (rtnl_wilddump_request(&rth, AF_INET6, RTM_GETROUTE) < 0) {
+	rtnl_close(&rth);
+	return -1;
+    }
+    d.table = table;
+    d.fn = fn;
+    d.arg = arg;
+    rc = rtnl_dump_filter(&rth, fib6_dump_one, &d);
+    rtnl_close(&rth);
+    return rc;
+}
 
+void fib6_print_head(void)
+{
     printf(_("Destination                    "
 	     "Next Hop                   "
 	     "Flag Met Ref Use If\n"));
+}
 
-    while (fgets(buff, 1023, fp)) {
-	num = sscanf(buff, "%4s%4s%4s%4s%4s%4s%4s%4s %02x %4s%4s%4s%4s%4s%4s%4s%4s %02x %4s%4s%4s%4s%4s%4s%4s%4s %08x %08x %08x %08x %15s\n",
-		     addr6p[0], addr6p[1], addr6p[2], addr6p[3],
-		     addr6p[4], addr6p[5], addr6p[6], addr6p[7],
-		     &prefix_len,
-		     saddr6p[0], saddr6p[1], saddr6p[2], saddr6p[3],
-		     saddr6p[4], saddr6p[5], saddr6p[6], saddr6p[7],
-		     &slen,
-		     naddr6p[0], naddr6p[1], naddr6p[2], naddr6p[3],
-		     naddr6p[4], naddr6p[5], naddr6p[6], naddr6p[7],
-		     &metric, &refcnt, &use, &iflags, iface);
-	if (0 && num < 23)
-	    continue;
-	if (iflags & RTF_CACHE) {
-		if (!(numeric & RTF_CACHE))
-			continue;
-	} else {
-		if (numeric & RTF_CACHE)
-			continue;
-	}
-
-	/* Fetch and resolve the target address. */
-	snprintf(addr6, sizeof(addr6), "%s:%s:%s:%s:%s:%s:%s:%s",
-		 addr6p[0], addr6p[1], addr6p[2], addr6p[3],
-		 addr6p[4], addr6p[5], addr6p[6], addr6p[7]);
-	inet6_aftype.input(1, addr6, (struct sockaddr *) &saddr6);
-	snprintf(addr6, sizeof(addr6), "%s/%d",
-		 inet6_aftype.sprint((struct sockaddr *) &saddr6, numeric),
-		 prefix_len);
+void fib6_print(FILE *fp, const struct fib6_entry *e, int numeric)
+{
+    char addr6[128], naddr6[128], flags[16], buf[INET6_ADDRSTRLEN];
+    unsigned int iflags = e->flags;
 
-	/* Fetch and resolve the nexthop address. */
-	snprintf(naddr6, sizeof(naddr6), "%s:%s:%s:%s:%s:%s:%s:%s",
-		 naddr6p[0], naddr6p[1], naddr6p[2], naddr6p[3],
-		 naddr6p[4], naddr6p[5], naddr6p[6], naddr6p[7]);
-	inet6_aftype.input(1, naddr6, (struct sockaddr *) &snaddr6);
-	snprintf(naddr6, sizeof(naddr6), "%s",
-		 inet6_aftype.sprint((struct sockaddr *) &snaddr6, numeric));
+    snprintf(addr6, sizeof(addr6), "%s/%d",
+	     fib6_sprint(&e->dst, numeric, buf), e->dst_len);
+    safe_strncpy(naddr6, fib6_sprint(&e->gw, numeric, buf), sizeof(naddr6));
 
 	/* Decode the flags. */
 
@@ -149,27 +404,87 @@ int rprint_fib6(int ext, int numeric)
 	    strcat(flags, "f");
 
 	/* Print the info. */
-	printf("%-30s %-26s %-4s %-3d %-1d%6d %s\n",
-	       addr6, naddr6, flags, metric, refcnt, use, iface);
+	fprintf(fp, "%-30s %-26s %-4s %-3d %-1d%6d %s\n",
+	       addr6, naddr6, flags, (int) e->metric, e->refcnt, e->use, e->iface);
+}
+
+struct fib6_show {
+    int numeric;
+    int cache;
+    int rows;
+};
+
+static int fib6_show(struct fib6_entry *e, void *arg)
+{
+    struct fib6_show *s = arg;
+
+    if (!(e->flags & RTF_CACHE) != !s->cache)
+	return 0;
+    fib6_print(stdout, e, s->numeric);
+    s->rows++;
+    return 0;
+}
+
+int rprint_fib6(int ext, int numeric)
+{
+    struct fib6_show s;
+    int table = route_table;
+
+    s.numeric = numeric & ~(RTF_CACHE | FLAG_PROC);
+    s.cache = numeric & RTF_CACHE;
+    s.rows = 0;
+
+    /* The cache fallback of rprint_cache6 needs /proc. */
+    if (!s.cache && !(numeric & FLAG_PROC)) {
+	if (table == FIB_TABLE_PROC)
+	    table = RT_TABLE_UNSPEC;
+	if (table == RT_TABLE_UNSPEC)
+	    printf(_("Kernel IPv6 routing table\n"));
+	else
+	    printf(_("Kernel IPv6 routing table %s\n"), route_table_name(table));
+	fib6_print_head();
+	if (fib6_read_netlink(table, fib6_show, &s) == 0)
+	    return 0;
+	if (s.rows || route_table != FIB_TABLE_PROC) {
+	    perror("RTM_GETROUTE");
+	    return 1;
+	}
+    } else {
+	if (s.cache)
+	    printf(_("Kernel IPv6 routing cache\n"));
+	else
+	    printf(_("Kernel IPv6 routing table\n"));
+	fib6_print_head();
     }
 
-    (void) fclose(fp);
-    return (0);
+    if (fib6_read_proc(fib6_show, &s) < 0) {
+	perror(_PATH_PROCNET_ROUTE6);
+        printf(_("INET6 (IPv6) not configured in this system.\n"));
+	return 1;
+    }
+    return 0;
 }
 
-int rprint_cache6(int ext, int numeric)
+int rprint_cache6(int ext, int numeric, int options)
 {
     char buff[4096], iface[16], flags[16];
-    char addr6[128], haddr[20], statestr[20];
-    struct sockaddr_in6 saddr6;
-    int type, refcnt, prefix_len, location, state, gc;
-    long tstamp, expire, ndflags, reachable, stale, delete;
-    FILE *fp = fopen(_PATH_PROCNET_NDISC, "r");
-    char addr6p[8][5], haddrp[6][3];
-
-    if (!fp) {
+    char addr6[128], haddr[20], statestr[20], buf[INET6_ADDRSTRLEN];
+    struct in6_addr a6;
+    unsigned char hw[6];
+    unsigned int f[10];
+    int refcnt, prefix_len, state, gc, i;
+    long tstamp, ndflags, reachable, stale, delete;
+    const char *p;
+    char *vbuf;
+    FILE *fp;
+
+    if (!(options & FLAG_PROC) && route_cache_netlink(AF_INET6, numeric, options) >= 0)
+	return 0;
+    if (!(fp = fopen(_PATH_PROCNET_NDISC, "r"))) {
 	return rprint_fib6(ext, numeric | RTF_CACHE);
     }
+    vbuf = xmalloc(PROC6_BUFSIZE);
+    setvbuf(fp, vbuf, _IOFBF, PROC6_BUFSIZE);
     printf(_("Kernel IPv6 Neighbour Cache\n"));
 
     if (ext == 2)
@@ -182,26 +497,38 @@ int rprint_cache6(int ext, int numeric)
 	"Iface    Flags Ref State            Stale(sec) Delete(sec)\n"));
 
 
-    while (fgets(buff, 1023, fp)) {
-	sscanf(buff, "%4s%4s%4s%4s%4s%4s%4s%4s %02x %02x %02x %02x %08lx %08lx %08lx %04x %04x %04lx %8s %2s%2s%2s%2s%2s%2s\n",
-		     addr6p[0], addr6p[1], addr6p[2], addr6p[3],
-		     addr6p[4], addr6p[5], addr6p[6], addr6p[7],
-		     &location, &prefix_len, &type, &state, &expire, &tstamp, &reachable, &gc, &refcnt,
-		     &ndflags, iface,
-	haddrp[0], haddrp[1], haddrp[2], haddrp[3], haddrp[4], haddrp[5]);
-
-	/* Fetch and resolve the nexthop address. */
-	snprintf(addr6, sizeof(addr6), "%s:%s:%s:%s:%s:%s:%s:%s",
-		 addr6p[0], addr6p[1], addr6p[2], addr6p[3],
-		 addr6p[4], addr6p[5], addr6p[6], addr6p[7]);
-	inet6_aftype.input(1, addr6, (struct sockaddr *) &saddr6);
+    while (fgets(buff, sizeof(buff), fp)) {
+	if (!(p = in6_field(buff, &a6)))
+	    continue;
+	for (i = 0; i < 10 && p; i++)
+	    p = hex_field(p, &f[i]);
+	if (!p)
+	    continue;
+	/* f[0] is the location, f[2] the type and f[4] the expiry. */
+	prefix_len = f[1];
+	state = f[3];
+	tstamp = f[5];
+	reachable = f[6];
+	gc = f[7];
+	refcnt = f[8];
+	ndflags = f[9];
+	while (*p == ' ')
+	    p++;
+	for (i = 0; i < 8 && *p > ' '; i++)
+	    iface[i] = *p++;
+	iface[i] = '\0';
+	while (*p == ' ')
+	    p++;
+	if (!hex_decode(p, hw, 12))
+	    memset(hw, 0, sizeof(hw));
+
+	/* Resolve the nexthop address. */
 	snprintf(addr6, sizeof(addr6), "%s/%d",
-	       inet6_aftype.sprint((struct sockaddr *) &saddr6, numeric),
-		 prefix_len);
+		 fib6_sprint(&a6, numeric, buf), prefix_len);
 
 	/* Fetch the  hardware address. */
-	snprintf(haddr, sizeof(haddr), "%s:%s:%s:%s:%s:%s",
-	haddrp[0], haddrp[1], haddrp[2], haddrp[3], haddrp[4], haddrp[5]);
+	snprintf(haddr, sizeof(haddr), "%02x:%02x:%02x:%02x:%02x:%02x",
+		 hw[0], hw[1], hw[2], hw[3], hw[4], hw[5]);
 
 	/* Decode the flags. */
 	flags[0] = '\0';
@@ -267,6 +594,7 @@ int rprint_cache6(int ext, int numeric)
     }
 
     (void) fclose(fp);
+    free(vbuf);
     return (0);
 }
 
@@ -277,11 +605,11 @@ int INET6_rprint(int options)
     int rc = E_INTERN;
 
     if (options & FLAG_FIB)
-	if ((rc = rprint_fib6(ext, numeric)))
+	if ((rc = rprint_fib6(ext, numeric | (options & FLAG_PROC))))
 	    return (rc);
 
     if (options & FLAG_CACHE)
-	if ((rc = rprint_cache6(ext, numeric)))
+	if ((rc = rprint_cache6(ext, numeric, options)))
 	    return (rc);
     return (rc);
 }
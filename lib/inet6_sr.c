@@ -34,6 +34,8 @@
 #include "intl.h"
 #include "net-features.h"
 #include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
 
 
 extern struct aftype inet6_aftype;
@@ -182,6 +184,72 @@ static int INET6_setroute(int action, int options, char **args)
     return (0);
 }
 
+/* The route -f form of INET6_setroute, see INET_rtnl_route(). */
+const char *INET6_rtnl_route(int action, char **args, struct nlmsghdr *n, int maxlen)
+{
+    struct rtmsg *r;
+    struct in6_addr dst, gw;
+    char target[128], *cp;
+    int plen = 128, ifindex = 0, metric = 1, gateway = 0;
+
+    r = route_rtnl_init(n, maxlen, action, AF_INET6);
+
+    if (*args == NULL)
+	return _("missing target");
+    safe_strncpy(target, *args++, sizeof(target));
+    if (!strcmp(target, "default")) {
+	memset(&dst, 0, sizeof(dst));
+	plen = 0;
+    } else {
+	if ((cp = strchr(target, '/')) != NULL) {
+	    *cp++ = '\0';
+	    if (!isdigit(*cp) || (plen = atoi(cp)) > 128)
+		return _("bad prefix length");
+	}
+	if (inet_pton(AF_INET6, target, &dst) <= 0)
+	    return _("target is not a numeric IPv6 address");
+    }
+
+    while (*args) {
+	if (!strcmp(*args, "metric")) {
+	    if (!*++args || !isdigit(**args))
+		return _("bad metric");
+	    metric = atoi(*args++);
+	    continue;
+	}
+	if (!strcmp(*args, "gw") || !strcmp(*args, "gateway")) {
+	    if (!*++args || gateway || inet_pton(AF_INET6, *args, &gw) <= 0)
+		return _("gateway is not a numeric IPv6 address");
+	    addattr_l(n, maxlen, RTA_GATEWAY, &gw, 16);
+	    gateway = 1;
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "mod") || !strcmp(*args, "dyn")) {
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "device") || !strcmp(*args, "dev")) {
+	    if (ifindex || !*++args)
+		return _("bad device");
+	} else if (ifindex || args[1])
+	    return _("unknown argument");
+	if ((ifindex = route_ifindex(*args)) == 0)
+	    return _("no such device");
+	addattr32(n, maxlen, RTA_OIF, ifindex);
+	args++;
+    }
+
+    r->rtm_dst_len = plen;
+    if (plen)
+	addattr_l(n, maxlen, RTA_DST, &dst, 16);
+    /* Adds get metric 1 like SIOCADDRT did; deletes without a metric
+       match any. */
+    if (action == RTACTION_ADD || metric != 1)
+	addattr32(n, maxlen, RTA_PRIORITY, metric);
+    return NULL;
+}
+
 int INET6_rinput(int action, int options, char **args)
 {
     if (action == RTACTION_FLUSH) {
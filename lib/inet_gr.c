@@ -32,91 +32,219 @@
 #include "net-features.h"
 #include "proc.h"
 #include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
 extern struct aftype inet_aftype;
 
 extern char *INET_sprintmask(struct sockaddr *sap, int numeric,
 			     unsigned int netmask);
 
-int rprint_fib(int ext, int numeric)
+/* /proc/net/route prints the raw __be32 values with %08X, so scanning
+   them back with %X on the same host gives network order again. */
+int fib4_read_proc(fib4_fn fn, void *arg)
 {
-    char buff[1024], iface[17], flags[64];
-    char gate_addr[128], net_addr[128];
-    char mask_addr[128];
-    int num, iflags, metric, refcnt, use, mss, window, irtt;
+    char buff[1024];
+    struct fib4_entry e;
+    unsigned int dst, gw, mask, m;
+    int num, rc = 0;
     FILE *fp = fopen(_PATH_PROCNET_ROUTE, "r");
     char *fmt;
 
-    if (!fp) {
-        perror(_PATH_PROCNET_ROUTE);
-        printf(_("INET (IPv4) not configured in this system.\n"));
-	return 1;
-    }
-    printf(_("Kernel IP routing table\n"));
-
-    if (ext == 1)
-	printf(_("Destination     Gateway         Genmask         "
-		 "Flags Metric Ref    Use Iface\n"));
-    if (ext == 2)
-	printf(_("Destination     Gateway         Genmask         "
-		 "Flags   MSS Window  irtt Iface\n"));
-    if (ext >= 3)
-	printf(_("Destination     Gateway         Genmask         "
-		 "Flags Metric Ref    Use Iface    "
-		 "MSS   Window irtt\n"));
-
-    irtt = 0;
-    window = 0;
-    mss = 0;
+    if (!fp)
+	return -1;
 
     fmt = proc_gen_fmt(_PATH_PROCNET_ROUTE, 0, fp,
 		       "Iface", "%15s",
-		       "Destination", "%127s",
-		       "Gateway", "%127s",
+		       "Destination", "%X",
+		       "Gateway", "%X",
 		       "Flags", "%X",
 		       "RefCnt", "%d",
 		       "Use", "%d",
 		       "Metric", "%d",
-		       "Mask", "%127s",
+		       "Mask", "%X",
 		       "MTU", "%d",
 		       "Window", "%d",
 		       "IRTT", "%d",
 		       NULL);
-    /* "%15s %127s %127s %X %d %d %d %127s %d %d %d\n" */
+    /* "%15s %X %X %X %d %d %d %X %d %d %d\n" */
 
-    if (!fmt)
-	return 1;
+    if (!fmt) {
+	fclose(fp);
+	return -1;
+    }
 
     while (fgets(buff, 1023, fp)) {
-        struct sockaddr snet_target, snet_gateway, snet_mask;
-	struct sockaddr_in *sin_netmask;
-
+	memset(&e, 0, sizeof(e));
 	num = sscanf(buff, fmt,
-		     iface, net_addr, gate_addr,
-		     &iflags, &refcnt, &use, &metric, mask_addr,
-		     &mss, &window, &irtt);
-	if (num < 10 || !(iflags & RTF_UP))
+		     e.iface, &dst, &gw,
+		     &e.flags, &e.refcnt, &e.use, &e.metric, &mask,
+		     &e.mss, &e.window, &e.irtt);
+	if (num < 10 || !(e.flags & RTF_UP))
 	    continue;
+	e.dst.s_addr = dst;
+	e.gw.s_addr = gw;
+	e.mask.s_addr = mask;
+	for (m = ntohl(mask); m; m <<= 1)
+	    e.dst_len++;
+	e.type = RTN_UNICAST;
+	e.table = RT_TABLE_MAIN;
+	if ((rc = fn(&e, arg)) < 0)
+	    break;
+    }
 
-	/* Fetch and resolve the target address. */
-	(void) inet_aftype.input(1, net_addr, &snet_target);
+    free(fmt);
+    (void) fclose(fp);
+    return rc < 0 ? rc : 0;
+}
 
-	/* Fetch and resolve the gateway address. */
-	(void) inet_aftype.input(1, gate_addr, &snet_gateway);
+/* Fill e from one RTM_NEWROUTE/RTM_DELROUTE message the way the kernel
+   fills a /proc/net/route row, taking the first hop of multipath routes.
+   Returns 0 for messages /proc would not show. */
+int fib4_parse(struct nlmsghdr *n, struct fib4_entry *e)
+{
+    struct rtmsg *r = NLMSG_DATA(n);
+    struct rtattr *tb[RTA_MAX + 1];
+    struct rtattr *gw, *oif;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*r));
+
+    if (len < 0 || r->rtm_family != AF_INET)
+	return 0;
+    if (r->rtm_type == RTN_BROADCAST || r->rtm_type == RTN_MULTICAST)
+	return 0;
+    parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+
+    memset(e, 0, sizeof(*e));
+    e->table = tb[RTA_TABLE] ? RTA_U32(tb[RTA_TABLE]) : r->rtm_table;
+    e->type = r->rtm_type;
+    e->protocol = r->rtm_protocol;
+    e->tos = r->rtm_tos;
+    e->dst_len = r->rtm_dst_len;
+    if (tb[RTA_DST])
+	memcpy(&e->dst, RTA_DATA(tb[RTA_DST]), 4);
+    if (r->rtm_dst_len)
+	e->mask.s_addr = htonl(~0U << (32 - r->rtm_dst_len));
+    if (tb[RTA_PRIORITY])
+	e->metric = RTA_U32(tb[RTA_PRIORITY]);
+
+    gw = tb[RTA_GATEWAY];
+    oif = tb[RTA_OIF];
+    /* /proc/net/route shows RTF_UP on dead (link down) routes too */
+    e->flags = RTF_UP;
+    if (tb[RTA_MULTIPATH] && RTA_PAYLOAD(tb[RTA_MULTIPATH]) >= sizeof(struct rtnexthop)) {
+	struct rtnexthop *nh = RTA_DATA(tb[RTA_MULTIPATH]);
+	struct rtattr *nt[RTA_MAX + 1];
+
+	parse_rtattr(nt, RTA_MAX, RTNH_DATA(nh), nh->rtnh_len - sizeof(*nh));
+	gw = nt[RTA_GATEWAY];
+	safe_strncpy(e->iface, route_ifname(nh->rtnh_ifindex), sizeof(e->iface));
+    } else {
+	safe_strncpy(e->iface, route_ifname(oif ? RTA_U32(oif) : 0), sizeof(e->iface));
+    }
+    if (gw) {
+	memcpy(&e->gw, RTA_DATA(gw), 4);
+	e->flags |= RTF_GATEWAY;
+    }
+    if (r->rtm_dst_len == 32)
+	e->flags |= RTF_HOST;
+    if (r->rtm_type == RTN_UNREACHABLE || r->rtm_type == RTN_PROHIBIT)
+	e->flags |= RTF_REJECT;
+    if (r->rtm_type == RTN_LOCAL)
+	e->flags |= RTF_LOCAL;
+
+    if (tb[RTA_METRICS]) {
+	struct rtattr *mx[RTAX_MAX + 1];
+
+	parse_rtattr(mx, RTAX_MAX, RTA_DATA(tb[RTA_METRICS]),
+		     RTA_PAYLOAD(tb[RTA_METRICS]));
+	if (mx[RTAX_ADVMSS])
+	    e->mss = RTA_U32(mx[RTAX_ADVMSS]) + 40;
+	if (mx[RTAX_WINDOW])
+	    e->window = RTA_U32(mx[RTAX_WINDOW]);
+	if (mx[RTAX_RTT])
+	    e->irtt = RTA_U32(mx[RTAX_RTT]) >> 3;
+    }
+    return 1;
+}
+
+struct fib4_dump {
+    int table;
+    fib4_fn fn;
+    void *arg;
+};
+
+static int fib4_dump_one(struct nlmsghdr *n, void *arg)
+{
+    struct fib4_dump *d = arg;
+    struct fib4_entry e;
+
+    if (n->nlmsg_type != RTM_NEWROUTE || !fib4_parse(n, &e))
+	return 0;
+    if (((struct rtmsg *) NLMSG_DATA(n))->rtm_flags & RTM_F_CLONED)
+	return 0;
+    if (d->table != RT_TABLE_UNSPEC && e.table != d->table)
+	return 0;
+    return d->fn(&e, d->arg);
+}
+
+/* Stream every IPv4 route of a table (RT_TABLE_UNSPEC for all of them)
+   to fn.  Returns -1 with nothing passed to fn when rtnetlink is not
+   usable, so the caller can fall back to /proc. */
+int fib4_read_netlink(int table, fib4_fn fn, void *arg)
+{
+    struct rtnl_handle rth;
+    struct fib4_dump d;
+    int rc;
+
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    if (rtnl_wilddump_request(&rth, AF_INET, RTM_GETROUTE) < 0) {
+	rtnl_close(&rth);
+	return -1;
+    }
+    d.table = table;
+    d.fn = fn;
+    d.arg = arg;
+    rc = rtnl_dump_filter(&rth, fib4_dump_one, &d);
+    rtnl_close(&rth);
+    return rc;
+}
+
+void fib4_print_head(int ext)
+{
+    if (ext == 1)
+	printf(_("Destination     Gateway         Genmask         "
+		 "Flags Metric Ref    Use Iface\n"));
+    if (ext == 2)
+	printf(_("Destination     Gateway         Genmask         "
+		 "Flags   MSS Window  irtt Iface\n"));
+    if (ext >= 3)
+	printf(_("Destination     Gateway         Genmask         "
+		 "Flags Metric Ref    Use Iface    "
+		 "MSS   Window irtt\n"));
+}
+
+void fib4_print(FILE *fp, const struct fib4_entry *e, int ext, int numeric)
+{
+    char gate_addr[128], net_addr[128], mask_addr[128], flags[64];
+    struct sockaddr_in sin;
+    unsigned int iflags = e->flags;
 
-	/* Fetch and resolve the genmask. */
-	(void) inet_aftype.input(1, mask_addr, &snet_mask);
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
 
-	sin_netmask = (struct sockaddr_in *)&snet_mask;
-	safe_strncpy(net_addr, INET_sprintmask(&snet_target,
-					 (numeric | 0x8000 | (iflags & RTF_HOST? 0x4000: 0)),
-					 sin_netmask->sin_addr.s_addr), sizeof(net_addr));
+    sin.sin_addr = e->dst;
+    safe_strncpy(net_addr, INET_sprintmask((struct sockaddr *) &sin,
+				     (numeric | 0x8000 | (iflags & RTF_HOST? 0x4000: 0)),
+				     e->mask.s_addr), sizeof(net_addr));
     net_addr[15] = '\0';
 
-	safe_strncpy(gate_addr, inet_aftype.sprint(&snet_gateway, numeric | 0x4000),
-                sizeof(gate_addr));
+    sin.sin_addr = e->gw;
+    safe_strncpy(gate_addr, inet_aftype.sprint((struct sockaddr *) &sin, numeric | 0x4000),
+		 sizeof(gate_addr));
     gate_addr[15] = '\0';
 
-	safe_strncpy(mask_addr, inet_aftype.sprint(&snet_mask, 1), sizeof(mask_addr));
+    sin.sin_addr = e->mask;
+    safe_strncpy(mask_addr, inet_aftype.sprint((struct sockaddr *) &sin, 1), sizeof(mask_addr));
     mask_addr[15] = '\0';
 
 	/* Decode the flags. */
@@ -168,44 +296,91 @@ int rprint_fib(int ext, int numeric)
 	if (ext == 1) {
 #if HAVE_RTF_REJECT
 	    if (iflags & RTF_REJECT)
-		printf("%-15s -               %-15s %-5s %-6d -  %7d -\n",
-		       net_addr, mask_addr, flags, metric, use);
+		fprintf(fp, "%-15s -               %-15s %-5s %-6d -  %7d -\n",
+		       net_addr, mask_addr, flags, e->metric, e->use);
 	    else
 #endif
-		printf("%-15s %-15s %-15s %-5s %-6d %-2d %7d %s\n",
+		fprintf(fp, "%-15s %-15s %-15s %-5s %-6d %-2d %7d %s\n",
 		       net_addr, gate_addr, mask_addr, flags,
-		       metric, refcnt, use, iface);
+		       e->metric, e->refcnt, e->use, e->iface);
 	}
 	if (ext == 2) {
 #if HAVE_RTF_REJECT
 	    if (iflags & RTF_REJECT)
-		printf("%-15s -               %-15s %-5s     - -          - -\n",
+		fprintf(fp, "%-15s -               %-15s %-5s     - -          - -\n",
 		       net_addr, mask_addr, flags);
 	    else
 #endif
-		printf("%-15s %-15s %-15s %-5s %5d %-5d %6d %s\n",
+		fprintf(fp, "%-15s %-15s %-15s %-5s %5d %-5d %6d %s\n",
 		       net_addr, gate_addr, mask_addr, flags,
-		       mss, window, irtt, iface);
+		       e->mss, e->window, e->irtt, e->iface);
 	}
 	if (ext >= 3) {
 #if HAVE_RTF_REJECT
 	    if (iflags & RTF_REJECT)
-		printf("%-15s -               %-15s %-5s %-6d -  %7d -        -     -      -\n",
-		       net_addr, mask_addr, flags, metric, use);
+		fprintf(fp, "%-15s -               %-15s %-5s %-6d -  %7d -        -     -      -\n",
+		       net_addr, mask_addr, flags, e->metric, e->use);
 	    else
 #endif
-		printf("%-15s %-15s %-15s %-5s %-6d %-3d %6d %-6.6s   %-5d %-6d %d\n",
+		fprintf(fp, "%-15s %-15s %-15s %-5s %-6d %-3d %6d %-6.6s   %-5d %-6d %d\n",
 		       net_addr, gate_addr, mask_addr, flags,
-		       metric, refcnt, use, iface, mss, window, irtt);
+		       e->metric, e->refcnt, e->use, e->iface, e->mss, e->window, e->irtt);
 	}
+}
+
+struct fib4_show {
+    int ext;
+    int numeric;
+    int rows;
+};
+
+static int fib4_show(struct fib4_entry *e, void *arg)
+{
+    struct fib4_show *s = arg;
+
+    fib4_print(stdout, e, s->ext, s->numeric);
+    s->rows++;
+    return 0;
+}
+
+int rprint_fib(int ext, int numeric, int options)
+{
+    struct fib4_show s;
+    int table = route_table;
+
+    s.ext = ext;
+    s.numeric = numeric;
+    s.rows = 0;
+
+    if (!(options & FLAG_PROC)) {
+	if (table == FIB_TABLE_PROC)
+	    table = RT_TABLE_MAIN;
+	if (table == RT_TABLE_MAIN)
+	    printf(_("Kernel IP routing table\n"));
+	else
+	    printf(_("Kernel IP routing table %s\n"), route_table_name(table));
+	fib4_print_head(ext);
+	if (fib4_read_netlink(table, fib4_show, &s) == 0)
+	    return 0;
+	if (s.rows || (route_table != FIB_TABLE_PROC && route_table != RT_TABLE_MAIN)) {
+	    perror("RTM_GETROUTE");
+	    return 1;
+	}
+	/* Only the headers are out; /proc has the main table too. */
+    } else {
+	printf(_("Kernel IP routing table\n"));
+	fib4_print_head(ext);
     }
 
-    free(fmt);
-    (void) fclose(fp);
-    return (0);
+    if (fib4_read_proc(fib4_show, &s) < 0) {
+	perror(_PATH_PROCNET_ROUTE);
+	printf(_("INET (IPv4) not configured in this system.\n"));
+	return 1;
+    }
+    return 0;
 }
 
-int rprint_cache(int ext, int numeric)
+int rprint_cache(int ext, int numeric, int options)
 {
     char buff[1024], iface[17], flags[64];
     char gate_addr[128], dest_addr[128], specdst[128];
@@ -215,9 +390,11 @@ int rprint_cache(int ext, int numeric)
     int num, format, metric, refcnt, use, mss, window, irtt, hh, hhref, hhuptod, arp, tos;
     char *fmt = NULL;
 
-    FILE *fp = fopen(_PATH_PROCNET_RTCACHE, "r");
+    FILE *fp;
 
-    if (!fp) {
+    if (!(options & FLAG_PROC) && route_cache_netlink(AF_INET, numeric, options) >= 0)
+	return 0;
+    if (!(fp = fopen(_PATH_PROCNET_RTCACHE, "r"))) {
         perror(_PATH_PROCNET_RTCACHE);
         printf(_("INET (IPv4) not configured in this system.\n"));
 	return 1;
@@ -446,10 +623,10 @@ int INET_rprint(int options)
     int rc = E_INTERN;
 
     if (options & FLAG_FIB)
-	if ((rc = rprint_fib(ext, numeric)))
+	if ((rc = rprint_fib(ext, numeric, options)))
 	    return (rc);
     if (options & FLAG_CACHE)
-	rc = rprint_cache(ext, numeric);
+	rc = rprint_cache(ext, numeric, options);
 
     return (rc);
 }
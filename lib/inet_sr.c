@@ -32,6 +32,8 @@
 #include "intl.h"
 #include "net-features.h"
 #include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
 
 #if HAVE_NEW_ADDRT
 #define mask_in_addr(x) (((struct sockaddr_in *)&((x).rt_genmask))->sin_addr.s_addr)
@@ -300,6 +302,137 @@ static int INET_setroute(int action, int options, char **args)
     return (0);
 }
 
+/* The route -f form of INET_setroute: the same arguments, but only
+   numeric addresses, turned into an RTM_NEWROUTE/RTM_DELROUTE request.
+   Returns NULL or what is wrong with the line. */
+const char *INET_rtnl_route(int action, char **args, struct nlmsghdr *n, int maxlen)
+{
+    struct rtmsg *r;
+    struct in_addr dst, gw, mask;
+    char mxbuf[64], target[128], *cp;
+    struct rtattr *mx = (struct rtattr *) mxbuf;
+    int xflag = 0, plen = -1, ifindex = 0, reject = 0, v;
+    unsigned int m;
+
+    r = route_rtnl_init(n, maxlen, action, AF_INET);
+    mx->rta_type = RTA_METRICS;
+    mx->rta_len = RTA_LENGTH(0);
+    gw.s_addr = 0;
+
+    if (*args && (!strcmp(*args, "-net") || !strcmp(*args, "#net"))) {
+	xflag = 1;
+	args++;
+    } else if (*args && (!strcmp(*args, "-host") || !strcmp(*args, "#host"))) {
+	xflag = 2;
+	args++;
+    }
+    if (*args == NULL)
+	return _("missing target");
+    safe_strncpy(target, *args++, sizeof(target));
+    if (!strcmp(target, "default")) {
+	dst.s_addr = 0;
+	plen = 0;
+    } else {
+	if ((cp = strchr(target, '/')) != NULL) {
+	    *cp++ = '\0';
+	    if (!isdigit(*cp) || (plen = atoi(cp)) > 32)
+		return _("bad prefix length");
+	}
+	if (inet_pton(AF_INET, target, &dst) <= 0)
+	    return _("target is not a numeric IPv4 address");
+    }
+
+    while (*args) {
+	if (!strcmp(*args, "metric")) {
+	    if (!*++args || !isdigit(**args))
+		return _("bad metric");
+	    addattr32(n, maxlen, RTA_PRIORITY, atoi(*args++));
+	    continue;
+	}
+	if (!strcmp(*args, "netmask")) {
+	    if (!*++args || plen >= 0 || inet_pton(AF_INET, *args, &mask) <= 0)
+		return _("bad netmask");
+	    m = ~ntohl(mask.s_addr);
+	    if (m & (m + 1))
+		return _("bad netmask");
+	    for (plen = 0, m = ~m; m; m <<= 1)
+		plen++;
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "gw") || !strcmp(*args, "gateway")) {
+	    if (!*++args || gw.s_addr || inet_pton(AF_INET, *args, &gw) <= 0)
+		return _("gateway is not a numeric IPv4 address");
+	    addattr_l(n, maxlen, RTA_GATEWAY, &gw, 4);
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "mss") || !strcmp(*args, "mtu")) {
+	    if (!*++args || (v = atoi(*args)) < 64 || v > 65536)
+		return _("Invalid MSS/MTU.");
+	    rta_addattr32(mx, sizeof(mxbuf), RTAX_ADVMSS, v - 40);
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "window")) {
+	    if (!*++args || (v = atoi(*args)) < 128)
+		return _("Invalid window.");
+	    rta_addattr32(mx, sizeof(mxbuf), RTAX_WINDOW, v);
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "irtt")) {
+	    if (!*++args)
+		return _("bad irtt");
+	    rta_addattr32(mx, sizeof(mxbuf), RTAX_RTT, atoi(*args++) << 3);
+	    continue;
+	}
+	if (!strcmp(*args, "reject")) {
+	    reject = 1;
+	    args++;
+	    continue;
+	}
+	/* only meaningful to the old ioctl, which ignores them too */
+	if (!strcmp(*args, "mod") || !strcmp(*args, "dyn") ||
+	    !strcmp(*args, "reinstate")) {
+	    args++;
+	    continue;
+	}
+	if (!strcmp(*args, "device") || !strcmp(*args, "dev")) {
+	    if (ifindex || !*++args)
+		return _("bad device");
+	} else if (ifindex || args[1])
+	    return _("unknown argument");
+	if ((ifindex = route_ifindex(*args)) == 0)
+	    return _("no such device");
+	addattr32(n, maxlen, RTA_OIF, ifindex);
+	args++;
+    }
+
+    if (plen < 0) {
+	if (xflag == 1)
+	    return _("network route needs a netmask or prefix length");
+	plen = 32;
+    }
+    if (xflag == 2 && plen != 32)
+	return _("netmask doesn't make sense with host route");
+    if (plen < 32 && (ntohl(dst.s_addr) << plen))
+	return _("netmask doesn't match route address");
+
+    r->rtm_dst_len = plen;
+    if (plen)
+	addattr_l(n, maxlen, RTA_DST, &dst, 4);
+    if (action == RTACTION_ADD) {
+	if (reject)
+	    r->rtm_type = RTN_UNREACHABLE;
+	else if (!gw.s_addr)
+	    r->rtm_scope = RT_SCOPE_LINK;
+	if (RTA_PAYLOAD(mx))
+	    addattr_l(n, maxlen, RTA_METRICS, RTA_DATA(mx), RTA_PAYLOAD(mx));
+    }
+    return NULL;
+}
+
 int INET_rinput(int action, int options, char **args)
 {
     if (action == RTACTION_FLUSH) {
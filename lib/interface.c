@@ -7,6 +7,14 @@
    8/2000  Andi Kleen make the list operations a bit more efficient.
    People are crazy enough to use thousands of aliases now.
 
+   10/2026 rtnetlink backend: the whole list, addresses and statistics
+   come from one RTM_GETLINK and one RTM_GETADDR dump.  The /proc and
+   ioctl code is kept as fallback.
+
+   10/2026 qdisc statistics: one RTM_GETQDISC dump, joined to the
+   cache by ifindex, printed by ife_print_long() as rates when there
+   is an earlier dump to compare with.
+
    $Id: interface.c,v 1.35 2011-01-01 03:22:31 ecki Exp $
  */
 
@@ -24,6 +32,9 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <string.h>
+#include <time.h>
+#include <linux/pkt_sched.h>
+#include <linux/gen_stats.h>
 
 #if HAVE_AFIPX
 #if (__GLIBC__ > 2) || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 1)
@@ -51,6 +62,7 @@
 #include "sockets.h"
 #include "util.h"
 #include "intl.h"
+#include "libnetlink.h"
 
 #ifdef IFF_PORTSEL
 const char *if_port_text[][4] =
@@ -90,39 +102,180 @@ int ife_short;
 
 int if_list_all = 0;	/* do we have requested the complete proc list, yet? */
 
+int if_qdisc_stats = 0;	/* for_all_interfaces() also reads the qdiscs */
+
+/*
+ * The cache is a list in nstrcmp() order for printing, plus a hash on the
+ * name and one on the ifindex for lookups.  Names arrive in any order
+ * (/proc/net/dev and rtnetlink dumps follow the kernel's hash order), so
+ * new entries are appended and the list is sorted once before it is
+ * walked instead of being kept sorted on every insert.
+ */
 static struct interface *int_list, *int_last;
+static struct interface **int_hash;	/* by name     */
+static struct interface **int_idx;	/* by ifindex  */
+static unsigned int int_hash_size, int_count;
+static int int_unsorted;
 
 static int if_readlist_proc(char *);
-static int if_readlist_rep(char *, struct interface *);
+static int if_readlist_refresh(void);
+static int if_readlist_netlink(void);
 
-static struct interface *if_cache_add(char *name)
+static unsigned int if_name_hash(const char *name)
 {
-    struct interface *ife, **nextp, *new;
+    unsigned int h = 5381;
+
+    while (*name)
+	h = h * 33 + (unsigned char) *name++;
+    return h;
+}
 
-    if (!int_list)
-    	int_last = NULL;
+static void if_cache_rehash(void)
+{
+    struct interface *ife;
+    unsigned int h;
 
-    /* the cache is sorted, so if we hit a smaller if, exit */
-    for (ife = int_last; ife; ife = ife->prev) {
-	    int n = nstrcmp(ife->name, name);
-	    if (n == 0)
-		    return ife;
-	    if (n < 0)
-		    break;
+    free(int_hash);
+    free(int_idx);
+    int_hash_size = int_hash_size ? int_hash_size * 2 : 256;
+    int_hash = xmalloc(int_hash_size * sizeof(*int_hash));
+    int_idx = xmalloc(int_hash_size * sizeof(*int_idx));
+    for (ife = int_list; ife; ife = ife->next) {
+	h = if_name_hash(ife->name) & (int_hash_size - 1);
+	ife->hash_next = int_hash[h];
+	int_hash[h] = ife;
+	if (ife->ifindex > 0 && ife->indexed) {
+	    h = ife->ifindex & (int_hash_size - 1);
+	    ife->index_next = int_idx[h];
+	    int_idx[h] = ife;
+	}
     }
+}
+
+static struct interface *if_cache_find(const char *name)
+{
+    struct interface *ife;
+
+    if (!int_hash_size)
+	return NULL;
+    for (ife = int_hash[if_name_hash(name) & (int_hash_size - 1)]; ife;
+	 ife = ife->hash_next)
+	if (!strcmp(ife->name, name))
+	    return ife;
+    return NULL;
+}
+
+static void if_cache_unindex(struct interface *ife)
+{
+    struct interface **pp;
+
+    if (!ife->indexed)
+	return;
+    for (pp = &int_idx[ife->ifindex & (int_hash_size - 1)]; *pp;
+	 pp = &(*pp)->index_next)
+	if (*pp == ife) {
+	    *pp = ife->index_next;
+	    break;
+	}
+    ife->indexed = 0;
+}
+
+/* Enter ife as the device with kernel index ifindex.  Aliases share the
+   index of their device and are never entered. */
+static void if_cache_set_index(struct interface *ife, int ifindex)
+{
+    struct interface *old;
+    unsigned int h;
+
+    if (ife->indexed && ife->ifindex == ifindex)
+	return;
+    if_cache_unindex(ife);
+    ife->ifindex = ifindex;
+    if (ifindex <= 0)
+	return;
+    /* an index reused by a renamed or recreated device */
+    if ((old = lookup_interface_index(ifindex)) != NULL)
+	if_cache_unindex(old);
+    h = ifindex & (int_hash_size - 1);
+    ife->index_next = int_idx[h];
+    int_idx[h] = ife;
+    ife->indexed = 1;
+}
+
+struct interface *lookup_interface_index(int ifindex)
+{
+    struct interface *ife;
+
+    if (!int_hash_size)
+	return NULL;
+    for (ife = int_idx[ifindex & (int_hash_size - 1)]; ife; ife = ife->index_next)
+	if (ife->ifindex == ifindex)
+	    return ife;
+    return NULL;
+}
+
+static struct interface *if_cache_add(char *name)
+{
+    struct interface *ife, *new;
+    unsigned int h;
+
+    if ((ife = if_cache_find(name)) != NULL)
+	return ife;
+
     new(new);
     safe_strncpy(new->name, name, IFNAMSIZ);
-    nextp = ife ? &ife->next : &int_list; // keep sorting
-    new->prev = ife;
-    new->next = *nextp;
-    if (new->next)
-	    new->next->prev = new;
-    else
-	    int_last = new;
-    *nextp = new;
+    nstrkey_init(&new->sortkey, new->name);
+
+    new->prev = int_last;
+    if (int_last) {
+	if (nstrkey_cmp(int_last->name, &int_last->sortkey,
+			new->name, &new->sortkey) > 0)
+	    int_unsorted = 1;
+	int_last->next = new;
+    } else
+	int_list = new;
+    int_last = new;
+
+    if (++int_count > int_hash_size)
+	if_cache_rehash();
+    else {
+	h = if_name_hash(new->name) & (int_hash_size - 1);
+	new->hash_next = int_hash[h];
+	int_hash[h] = new;
+    }
     return new;
 }
 
+static int if_sort_cmp(const void *a, const void *b)
+{
+    const struct interface *ia = *(const struct interface **) a;
+    const struct interface *ib = *(const struct interface **) b;
+
+    return nstrkey_cmp(ia->name, &ia->sortkey, ib->name, &ib->sortkey);
+}
+
+/* Put int_list back into nstrcmp() order. */
+static void if_cache_sort(void)
+{
+    struct interface **v, *ife;
+    unsigned int i = 0;
+
+    if (!int_unsorted)
+	return;
+    v = xmalloc(int_count * sizeof(*v));
+    for (ife = int_list; ife; ife = ife->next)
+	v[i++] = ife;
+    qsort(v, int_count, sizeof(*v), if_sort_cmp);
+    int_list = v[0];
+    for (i = 0; i < int_count; i++) {
+	v[i]->prev = i ? v[i - 1] : NULL;
+	v[i]->next = i + 1 < int_count ? v[i + 1] : NULL;
+    }
+    int_last = v[int_count - 1];
+    free(v);
+    int_unsorted = 0;
+}
+
 struct interface *lookup_interface(char *name)
 {
    /* if we have read all, use it */
@@ -141,10 +294,20 @@ int for_all_interfaces(int (*doit) (struct interface *, void *), void *cookie)
     struct interface *ife;
     int err;
 
-    if (!if_list_all && (if_readlist() < 0))
+    /* One pass over /proc/net/dev fills the statistics of every cached
+       interface; a cache kept over several calls (netstat -c) is
+       refreshed the same way instead of rescanning the file for each
+       interface. */
+    if (!if_list_all) {
+	if (if_readlist() < 0)
+	    return -1;
+    } else if (if_readlist_refresh() < 0)
 	return -1;
+    /* the qdiscs are extra information, nothing to fail for */
+    if (if_qdisc_stats)
+	if_readqdisc();
+    if_cache_sort();
     for (ife = int_list; ife; ife = ife->next) {
-	if_readlist_rep(ife->name, ife);
 	err = doit(ife, cookie);
 
 	if (err)
@@ -153,14 +316,41 @@ int for_all_interfaces(int (*doit) (struct interface *, void *), void *cookie)
     return 0;
 }
 
+static void if_addrs_free(struct interface *ife)
+{
+    struct interface_addr *ia;
+
+    while ((ia = ife->addrs) != NULL) {
+	ife->addrs = ia->next;
+	free(ia);
+    }
+}
+
+static void if_qdiscs_free(struct interface *ife)
+{
+    struct interface_qdisc *qd;
+
+    while ((qd = ife->qdiscs) != NULL) {
+	ife->qdiscs = qd->next;
+	free(qd);
+    }
+}
+
 int if_cache_free(void)
 {
     struct interface *ife;
     while ((ife = int_list) != NULL) {
 	int_list = ife->next;
+	if_addrs_free(ife);
+	if_qdiscs_free(ife);
 	free(ife);
     }
     int_last = NULL;
+    free(int_hash);
+    free(int_idx);
+    int_hash = int_idx = NULL;
+    int_hash_size = int_count = 0;
+    int_unsorted = 0;
     if_list_all = 0;
     return 0;
 }
@@ -269,7 +459,7 @@ int get_dev_fields(char *bp, struct interface *ife)
     switch (procnetdev_vsn) {
     case 3:
 	sscanf(bp,
-	"%Lu %Lu %lu %lu %lu %lu %lu %lu %Lu %Lu %lu %lu %lu %lu %lu %lu",
+	"%Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu",
 	       &ife->stats.rx_bytes,
 	       &ife->stats.rx_packets,
 	       &ife->stats.rx_errors,
@@ -289,7 +479,7 @@ int get_dev_fields(char *bp, struct interface *ife)
 	       &ife->stats.tx_compressed);
 	break;
     case 2:
-	sscanf(bp, "%Lu %Lu %lu %lu %lu %lu %Lu %Lu %lu %lu %lu %lu %lu",
+	sscanf(bp, "%Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu",
 	       &ife->stats.rx_bytes,
 	       &ife->stats.rx_packets,
 	       &ife->stats.rx_errors,
@@ -307,7 +497,7 @@ int get_dev_fields(char *bp, struct interface *ife)
 	ife->stats.rx_multicast = 0;
 	break;
     case 1:
-	sscanf(bp, "%Lu %lu %lu %lu %lu %Lu %lu %lu %lu %lu %lu",
+	sscanf(bp, "%Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu %Lu",
 	       &ife->stats.rx_packets,
 	       &ife->stats.rx_errors,
 	       &ife->stats.rx_dropped,
@@ -398,49 +588,461 @@ static int if_readlist_proc(char *target)
     return err;
 }
 
-static int if_readlist_rep(char *target, struct interface *ife)
+/* Update the statistics of all cached interfaces with one read of
+   /proc/net/dev.  Interfaces that vanished meanwhile lose their
+   statistics, new ones are added to the cache. */
+static int if_readlist_refresh(void)
 {
-    FILE *fh;
+    struct interface *ife;
     int err;
-    char *line = NULL;
-    size_t linelen = 0;
 
-    fh = fopen(_PATH_PROCNET_DEV, "r");
-    if (!fh) {
-		fprintf(stderr, _("Warning: cannot open %s (%s). Limited output.\n"),
-			_PATH_PROCNET_DEV, strerror(errno)); 
-		return if_readconf();
+    if (if_readlist_netlink() == 0)
+	return 0;
+
+    for (ife = int_list; ife; ife = ife->next)
+	ife->statistics_valid = 0;
+
+    err = if_readlist_proc(NULL);
+    if (err == -2)
+	return if_readconf();
+    return err;
+}
+
+/* rtnetlink backend.  The link dump gives flags, hardware address, MTU,
+   queue length, map and the 64 bit counters, the address dump all IPv4
+   and IPv6 addresses including secondaries and labeled aliases. */
+
+/* IFLA_STATS64 as of Linux 5.19.  The kernel only ever appends to it,
+   so a private copy lets us read the newer counters whatever age the
+   installed headers are; older kernels send less and the rest stays 0. */
+struct nl_link_stats64 {
+    __u64 rx_packets, tx_packets, rx_bytes, tx_bytes;
+    __u64 rx_errors, tx_errors, rx_dropped, tx_dropped;
+    __u64 multicast, collisions;
+    __u64 rx_length_errors, rx_over_errors, rx_crc_errors;
+    __u64 rx_frame_errors, rx_fifo_errors, rx_missed_errors;
+    __u64 tx_aborted_errors, tx_carrier_errors, tx_fifo_errors;
+    __u64 tx_heartbeat_errors, tx_window_errors;
+    __u64 rx_compressed, tx_compressed;
+    __u64 rx_nohandler;
+    __u64 rx_otherhost_dropped;
+};
+
+/* Fold the detailed counters the way /proc/net/dev does, so both
+   backends print the same numbers. */
+static void nl_fill_stats(struct user_net_device_stats *st,
+			  const struct nl_link_stats64 *s)
+{
+    st->rx_packets = s->rx_packets;
+    st->tx_packets = s->tx_packets;
+    st->rx_bytes = s->rx_bytes;
+    st->tx_bytes = s->tx_bytes;
+    st->rx_errors = s->rx_errors;
+    st->tx_errors = s->tx_errors;
+    st->rx_dropped = s->rx_dropped + s->rx_missed_errors;
+    st->tx_dropped = s->tx_dropped;
+    st->rx_multicast = s->multicast;
+    st->rx_compressed = s->rx_compressed;
+    st->tx_compressed = s->tx_compressed;
+    st->collisions = s->collisions;
+    st->rx_length_errors = s->rx_length_errors;
+    st->rx_over_errors = s->rx_over_errors;
+    st->rx_crc_errors = s->rx_crc_errors;
+    st->rx_frame_errors = s->rx_length_errors + s->rx_over_errors +
+	s->rx_crc_errors + s->rx_frame_errors;
+    st->rx_fifo_errors = s->rx_fifo_errors;
+    st->rx_missed_errors = s->rx_missed_errors;
+    st->tx_aborted_errors = s->tx_aborted_errors;
+    st->tx_carrier_errors = s->tx_carrier_errors + s->tx_aborted_errors +
+	s->tx_window_errors + s->tx_heartbeat_errors;
+    st->tx_fifo_errors = s->tx_fifo_errors;
+    st->tx_heartbeat_errors = s->tx_heartbeat_errors;
+    st->tx_window_errors = s->tx_window_errors;
+    st->rx_nohandler = s->rx_nohandler;
+    st->rx_otherhost_dropped = s->rx_otherhost_dropped;
+}
+
+static void nl_stats32(struct nl_link_stats64 *d, const struct rtnl_link_stats *s)
+{
+    memset(d, 0, sizeof(*d));
+    d->rx_packets = s->rx_packets;
+    d->tx_packets = s->tx_packets;
+    d->rx_bytes = s->rx_bytes;
+    d->tx_bytes = s->tx_bytes;
+    d->rx_errors = s->rx_errors;
+    d->tx_errors = s->tx_errors;
+    d->rx_dropped = s->rx_dropped;
+    d->tx_dropped = s->tx_dropped;
+    d->multicast = s->multicast;
+    d->collisions = s->collisions;
+    d->rx_length_errors = s->rx_length_errors;
+    d->rx_over_errors = s->rx_over_errors;
+    d->rx_crc_errors = s->rx_crc_errors;
+    d->rx_frame_errors = s->rx_frame_errors;
+    d->rx_fifo_errors = s->rx_fifo_errors;
+    d->rx_missed_errors = s->rx_missed_errors;
+    d->tx_aborted_errors = s->tx_aborted_errors;
+    d->tx_carrier_errors = s->tx_carrier_errors;
+    d->tx_fifo_errors = s->tx_fifo_errors;
+    d->tx_heartbeat_errors = s->tx_heartbeat_errors;
+    d->tx_window_errors = s->tx_window_errors;
+    d->rx_compressed = s->rx_compressed;
+    d->tx_compressed = s->tx_compressed;
+}
+
+static int nl_link(struct nlmsghdr *n, void *arg)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(n);
+    struct rtattr *tb[IFLA_MAX + 1];
+    struct interface *ife;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+
+    if (n->nlmsg_type != RTM_NEWLINK || len < 0)
+	return 0;
+    parse_rtattr(tb, IFLA_MAX, IFLA_RTA(ifi), len);
+    if (!tb[IFLA_IFNAME])
+	return 0;
+
+    ife = if_cache_add(RTA_DATA(tb[IFLA_IFNAME]));
+    if_cache_set_index(ife, ifi->ifi_index);
+    ife->type = ifi->ifi_type;
+    ife->flags = ifi->ifi_flags;
+
+    memset(ife->hwaddr, 0, sizeof(ife->hwaddr));
+    if (tb[IFLA_ADDRESS])
+	memcpy(ife->hwaddr, RTA_DATA(tb[IFLA_ADDRESS]),
+	       netmin(RTA_PAYLOAD(tb[IFLA_ADDRESS]), sizeof(ife->hwaddr)));
+
+    ife->mtu = tb[IFLA_MTU] ? RTA_U32(tb[IFLA_MTU]) : 0;
+    ife->tx_queue_len = tb[IFLA_TXQLEN] ? RTA_U32(tb[IFLA_TXQLEN]) : -1;
+
+    memset(&ife->map, 0, sizeof(ife->map));
+    if (tb[IFLA_MAP] && RTA_PAYLOAD(tb[IFLA_MAP]) >= sizeof(struct rtnl_link_ifmap)) {
+	struct rtnl_link_ifmap *map = RTA_DATA(tb[IFLA_MAP]);
+	ife->map.mem_start = map->mem_start;
+	ife->map.mem_end = map->mem_end;
+	ife->map.base_addr = map->base_addr;
+	ife->map.irq = map->irq;
+	ife->map.dma = map->dma;
+	ife->map.port = map->port;
+    }
+
+    if (tb[IFLA_STATS64] && RTA_PAYLOAD(tb[IFLA_STATS64]) >= offsetof(struct nl_link_stats64, rx_compressed)) {
+	struct nl_link_stats64 s64;
+	memset(&s64, 0, sizeof(s64));
+	memcpy(&s64, RTA_DATA(tb[IFLA_STATS64]),
+	       netmin(RTA_PAYLOAD(tb[IFLA_STATS64]), sizeof(s64)));
+	nl_fill_stats(&ife->stats, &s64);
+	ife->statistics_valid = 1;
+    } else if (tb[IFLA_STATS] && RTA_PAYLOAD(tb[IFLA_STATS]) >= sizeof(struct rtnl_link_stats) - sizeof(__u32)) {
+	struct rtnl_link_stats s32;
+	struct nl_link_stats64 s64;
+	memset(&s32, 0, sizeof(s32));
+	memcpy(&s32, RTA_DATA(tb[IFLA_STATS]),
+	       netmin(RTA_PAYLOAD(tb[IFLA_STATS]), sizeof(s32)));
+	nl_stats32(&s64, &s32);
+	nl_fill_stats(&ife->stats, &s64);
+	ife->statistics_valid = 1;
+    }
+    ife->netlink = 1;
+    return 0;
+}
+
+static void nl_prefix_to_mask(struct sockaddr *sa, int plen)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *) sa;
+
+    memset(sa, 0, sizeof(*sa));
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = plen ? htonl(0xffffffffU << (32 - plen)) : 0;
+}
+
+/* a missing attribute gives 0.0.0.0, like the ioctls do */
+static void nl_inet_sockaddr(struct sockaddr *sa, struct rtattr *rta)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *) sa;
+
+    memset(sa, 0, sizeof(*sa));
+    sin->sin_family = AF_INET;
+    if (rta && RTA_PAYLOAD(rta) >= 4)
+	memcpy(&sin->sin_addr, RTA_DATA(rta), 4);
+}
+
+/* /proc/net/if_inet6 shows the kernel's address type scope bits, not the
+   rtnetlink scope; translate so the output does not change. */
+static int nl_inet6_scope(int scope, const struct in6_addr *a)
+{
+    switch (scope) {
+    case RT_SCOPE_HOST:
+	return IPV6_ADDR_LOOPBACK;
+    case RT_SCOPE_LINK:
+	return IPV6_ADDR_LINKLOCAL;
+    case RT_SCOPE_SITE:
+	return IPV6_ADDR_SITELOCAL;
+    }
+    if (a->s6_addr32[0] == 0 && a->s6_addr32[1] == 0 && a->s6_addr32[2] == 0 &&
+	a->s6_addr32[3] != 0 && a->s6_addr32[3] != htonl(1))
+	return IPV6_ADDR_COMPATv4;
+    return 0;
+}
+
+static int nl_addr(struct nlmsghdr *n, void *arg)
+{
+    struct ifaddrmsg *ifa = NLMSG_DATA(n);
+    struct rtattr *tb[IFA_MAX + 1];
+    struct interface *ife, *link;
+    struct interface_addr *ia;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa));
+
+    if (n->nlmsg_type != RTM_NEWADDR || len < 0)
+	return 0;
+    parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa), len);
+    if (!tb[IFA_LOCAL])
+	tb[IFA_LOCAL] = tb[IFA_ADDRESS];
+    if (!tb[IFA_LOCAL])
+	return 0;
+    if ((link = ife = lookup_interface_index(ifa->ifa_index)) == NULL)
+	return 0;
+
+    switch (ifa->ifa_family) {
+#if HAVE_AFINET
+    case AF_INET:
+	if (RTA_PAYLOAD(tb[IFA_LOCAL]) < 4)
+	    return 0;
+	/* "eth0:1" style aliases live in the cache as interfaces of their
+	   own, sharing everything but the address with the device */
+	if (tb[IFA_LABEL] && strcmp(RTA_DATA(tb[IFA_LABEL]), link->name)) {
+	    ife = if_cache_add(RTA_DATA(tb[IFA_LABEL]));
+	    if (!ife->netlink) {
+		ife->ifindex = link->ifindex;
+		ife->type = link->type;
+		ife->flags = link->flags;
+		ife->mtu = link->mtu;
+		ife->tx_queue_len = link->tx_queue_len;
+		ife->map = link->map;
+		memcpy(ife->hwaddr, link->hwaddr, sizeof(ife->hwaddr));
+		ife->netlink = 1;
+	    }
 	}
-    if (getline(&line, &linelen, fh) == -1 /* eat line */
-	|| getline(&line, &linelen, fh) == -1) { /* eat line */
-		err = -1;
-		goto out;
+	if (!ife->has_ip) {
+	    ife->has_ip = 1;
+	    nl_inet_sockaddr(&ife->addr, tb[IFA_LOCAL]);
+	    nl_prefix_to_mask(&ife->netmask, ifa->ifa_prefixlen);
+	    nl_inet_sockaddr(&ife->dstaddr, tb[IFA_ADDRESS]);
+	    nl_inet_sockaddr(&ife->broadaddr, tb[IFA_BROADCAST]);
+	    return 0;
 	}
+	new(ia);
+	ia->family = AF_INET;
+	ia->prefixlen = ifa->ifa_prefixlen;
+	nl_inet_sockaddr((struct sockaddr *) &ia->addr, tb[IFA_LOCAL]);
+	nl_prefix_to_mask(&ia->netmask, ifa->ifa_prefixlen);
+	nl_inet_sockaddr(&ia->dstaddr, tb[IFA_ADDRESS]);
+	nl_inet_sockaddr(&ia->broadaddr, tb[IFA_BROADCAST]);
+	break;
+#endif
+#if HAVE_AFINET6
+    case AF_INET6: {
+	struct sockaddr_in6 *sin6;
+
+	if (RTA_PAYLOAD(tb[IFA_LOCAL]) < 16)
+	    return 0;
+	new(ia);
+	ia->family = AF_INET6;
+	ia->prefixlen = ifa->ifa_prefixlen;
+	sin6 = (struct sockaddr_in6 *) &ia->addr;
+	sin6->sin6_family = AF_INET6;
+	memcpy(&sin6->sin6_addr, RTA_DATA(tb[IFA_LOCAL]), 16);
+	ia->scope = nl_inet6_scope(ifa->ifa_scope, &sin6->sin6_addr);
+	break;
+    }
+#endif
+    default:
+	return 0;
+    }
+    /* prepended here, put back into kernel order when the dump is done */
+    ia->next = ife->addrs;
+    ife->addrs = ia;
+    return 0;
+}
 
-    procnetdev_vsn = procnetdev_version(line);
+static int if_readlist_netlink(void)
+{
+    struct rtnl_handle rth;
+    struct interface *ife;
+    int err = -1;
 
-    err = 0;
-    while (getline(&line, &linelen, fh) != -1) {
-	char *s, *name;
-	s = get_name(&name, line);    
-	get_dev_fields(s, ife);
-	if (target && !strcmp(target,name))
-	{
-		ife->statistics_valid = 1;
-		break;
-	}
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+
+    for (ife = int_list; ife; ife = ife->next) {
+	ife->netlink = 0;
+	ife->statistics_valid = 0;
+	ife->has_ip = 0;
+	memset(&ife->addr, 0, sizeof(ife->addr));
+	if_addrs_free(ife);
     }
-    if (ferror(fh)) {
-	perror(_PATH_PROCNET_DEV);
-	err = -1;
+
+    if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETLINK) < 0 ||
+	rtnl_dump_filter(&rth, nl_link, NULL) < 0)
+	goto out;
+    if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETADDR) < 0 ||
+	rtnl_dump_filter(&rth, nl_addr, NULL) < 0)
+	goto out;
+
+    for (ife = int_list; ife; ife = ife->next) {
+	struct interface_addr *ia, *rev = NULL;
+	while ((ia = ife->addrs) != NULL) {
+	    ife->addrs = ia->next;
+	    ia->next = rev;
+	    rev = ia;
+	}
+	ife->addrs = rev;
     }
+    err = 0;
 
-  out:
-    free(line);
-    fclose(fh);
+out:
+    if (err < 0)
+	for (ife = int_list; ife; ife = ife->next)
+	    ife->netlink = 0;
+    rtnl_close(&rth);
     return err;
 }
 
+/* One RTM_GETQDISC dump for all interfaces.  Entries are matched by
+   handle and parent so that the previous counters survive for rates;
+   qdiscs that went away are dropped. */
+
+static double qdisc_interval;
+
+static int nl_qdisc(struct nlmsghdr *n, void *arg)
+{
+    struct tcmsg *t = NLMSG_DATA(n);
+    struct rtattr *tb[TCA_MAX + 1];
+    struct interface *ife;
+    struct interface_qdisc *qd, **pp;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*t));
+    int fresh = 0;
+
+    if (n->nlmsg_type != RTM_NEWQDISC || len < 0)
+	return 0;
+    if ((ife = lookup_interface_index(t->tcm_ifindex)) == NULL)
+	return 0;
+    parse_rtattr(tb, TCA_MAX, TCA_RTA(t), len);
+    if (!tb[TCA_KIND])
+	return 0;
+
+    /* keep the dump order, which lists the root first */
+    for (pp = &ife->qdiscs; (qd = *pp) != NULL; pp = &qd->next)
+	if (qd->handle == t->tcm_handle && qd->parent == t->tcm_parent &&
+	    !qd->seen)
+	    break;
+    if (qd && strncmp(qd->kind, RTA_DATA(tb[TCA_KIND]), sizeof(qd->kind))) {
+	/* replaced by a different qdisc, counters start over */
+	memset(&qd->stats, 0, sizeof(qd->stats));
+	fresh = 1;
+    }
+    if (!qd) {
+	qd = xmalloc(sizeof(*qd));
+	memset(qd, 0, sizeof(*qd));
+	qd->handle = t->tcm_handle;
+	qd->parent = t->tcm_parent;
+	*pp = qd;
+	fresh = 1;
+    }
+    safe_strncpy(qd->kind, RTA_DATA(tb[TCA_KIND]), sizeof(qd->kind));
+    qd->interval = fresh ? 0 : qdisc_interval;
+    qd->prev = qd->stats;
+    qd->seen = 1;
+
+    if (tb[TCA_STATS2]) {
+	struct rtattr *st[TCA_STATS_MAX + 1];
+
+	parse_rtattr(st, TCA_STATS_MAX, RTA_DATA(tb[TCA_STATS2]),
+		     RTA_PAYLOAD(tb[TCA_STATS2]));
+	if (st[TCA_STATS_BASIC]) {
+	    struct gnet_stats_basic b;
+	    memset(&b, 0, sizeof(b));
+	    memcpy(&b, RTA_DATA(st[TCA_STATS_BASIC]),
+		   netmin(RTA_PAYLOAD(st[TCA_STATS_BASIC]), sizeof(b)));
+	    qd->stats.bytes = b.bytes;
+	    qd->stats.packets = b.packets;
+	}
+#ifdef TCA_STATS_PKT64
+	if (st[TCA_STATS_PKT64] && RTA_PAYLOAD(st[TCA_STATS_PKT64]) >= sizeof(__u64))
+	    memcpy(&qd->stats.packets, RTA_DATA(st[TCA_STATS_PKT64]), sizeof(__u64));
+#endif
+	if (st[TCA_STATS_QUEUE]) {
+	    struct gnet_stats_queue q;
+	    memset(&q, 0, sizeof(q));
+	    memcpy(&q, RTA_DATA(st[TCA_STATS_QUEUE]),
+		   netmin(RTA_PAYLOAD(st[TCA_STATS_QUEUE]), sizeof(q)));
+	    qd->qlen = q.qlen;
+	    qd->backlog = q.backlog;
+	    qd->stats.drops = q.drops;
+	    qd->stats.overlimits = q.overlimits;
+	    qd->stats.requeues = q.requeues;
+	}
+    } else if (tb[TCA_STATS]) {
+	struct tc_stats ts;
+	memset(&ts, 0, sizeof(ts));
+	memcpy(&ts, RTA_DATA(tb[TCA_STATS]),
+	       netmin(RTA_PAYLOAD(tb[TCA_STATS]), sizeof(ts)));
+	qd->stats.bytes = ts.bytes;
+	qd->stats.packets = ts.packets;
+	qd->stats.drops = ts.drops;
+	qd->stats.overlimits = ts.overlimits;
+	qd->qlen = ts.qlen;
+	qd->backlog = ts.backlog;
+    }
+    return 0;
+}
+
+int if_readqdisc(void)
+{
+    static struct timespec last;
+    struct timespec now;
+    struct rtnl_handle rth;
+    struct interface *ife;
+    struct interface_qdisc *qd, **pp;
+    struct tcmsg t;
+    int err;
+
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    qdisc_interval = 0;
+    if (last.tv_sec || last.tv_nsec)
+	qdisc_interval = (now.tv_sec - last.tv_sec) +
+			 (now.tv_nsec - last.tv_nsec) / 1e9;
+    last = now;
+
+    for (ife = int_list; ife; ife = ife->next)
+	for (qd = ife->qdiscs; qd; qd = qd->next)
+	    qd->seen = 0;
+
+    memset(&t, 0, sizeof(t));
+    t.tcm_family = AF_UNSPEC;
+    err = rtnl_dump_request(&rth, RTM_GETQDISC, &t, sizeof(t));
+    if (err >= 0)
+	err = rtnl_dump_filter(&rth, nl_qdisc, NULL);
+    rtnl_close(&rth);
+
+    for (ife = int_list; ife; ife = ife->next) {
+	pp = &ife->qdiscs;
+	while ((qd = *pp) != NULL) {
+	    if (qd->seen || err < 0) {
+		pp = &qd->next;
+		continue;
+	    }
+	    *pp = qd->next;
+	    free(qd);
+	}
+    }
+    return err < 0 ? -1 : 0;
+}
+
 int if_readlist(void)
 {
     /* caller will/should check not to call this too often
@@ -448,6 +1050,11 @@ int if_readlist(void)
      */
     int proc_err, conf_err;
 
+    if (if_readlist_netlink() == 0) {
+	if_list_all = 1;
+	return 0;
+    }
+
     proc_err = if_readlist_proc(NULL);
     conf_err = if_readconf();
 
@@ -469,8 +1076,8 @@ static int ipx_getaddr(int sock, int ft, struct ifreq *ifr)
 }
 #endif
 
-/* Fetch the interface configuration from the kernel. */
-int if_fetch(struct interface *ife)
+/* Fetch link level and IPv4 configuration with the classic ioctls. */
+static int if_fetch_ioctl(struct interface *ife)
 {
     struct ifreq ifr;
     int fd;
@@ -569,6 +1176,20 @@ int if_fetch(struct interface *ife)
     }
 #endif
 
+    return 0;
+}
+
+/* Fetch the interface configuration from the kernel.  Interfaces read
+   through rtnetlink only need the address families netlink can't see. */
+int if_fetch(struct interface *ife)
+{
+    struct ifreq ifr;
+    int fd;
+    char *ifname = ife->name;
+
+    if (!ife->netlink && if_fetch_ioctl(ife) < 0)
+	return -1;
+
 #if HAVE_AFATALK
     /* DDP address maybe ? */
     fd = get_socket_for_af(AF_APPLETALK);
@@ -659,10 +1280,10 @@ void ife_print_short(struct interface *ptr)
     printf("%5d ", ptr->mtu);
     /* If needed, display the interface statistics. */
     if (ptr->statistics_valid) {
-	printf("%8llu %6lu %6lu %-6lu ",
+	printf("%8llu %6llu %6llu %-6llu ",
 	       ptr->stats.rx_packets, ptr->stats.rx_errors,
 	       ptr->stats.rx_dropped, ptr->stats.rx_fifo_errors);
-	printf("%8llu %6lu %6lu %6lu ",
+	printf("%8llu %6llu %6llu %6llu ",
 	       ptr->stats.tx_packets, ptr->stats.tx_errors,
 	       ptr->stats.tx_dropped, ptr->stats.tx_fifo_errors);
     } else {
@@ -705,6 +1326,97 @@ void ife_print_short(struct interface *ptr)
     printf("\n");
 }
 
+/* packets are 32 bit unless the kernel has TCA_STATS_PKT64 */
+static unsigned long long qdisc_delta(unsigned long long cur,
+				      unsigned long long prev)
+{
+    if (cur < prev && prev <= 0xffffffffULL)
+	return cur + 0x100000000ULL - prev;
+    return cur - prev;
+}
+
+static void ife_print_qdisc(struct interface_qdisc *qd)
+{
+    struct qdisc_stats *c = &qd->stats, *p = &qd->prev;
+    double dt = qd->interval;
+
+    printf(_("        qdisc %s %x:"), qd->kind, TC_H_MAJ(qd->handle) >> 16);
+    if (TC_H_MIN(qd->handle))
+	printf("%x", TC_H_MIN(qd->handle));
+    if (qd->parent == TC_H_ROOT)
+	printf(_(" root"));
+    else if (qd->parent == TC_H_INGRESS)
+	printf(_(" ingress"));
+    else
+	printf(_(" parent %x:%x"), TC_H_MAJ(qd->parent) >> 16,
+	       TC_H_MIN(qd->parent));
+    printf(_("  qlen %u  backlog %u bytes\n"), qd->qlen, qd->backlog);
+
+    printf("        ");
+    if (dt > 0) {
+	/* the u32 counters wrap, unsigned arithmetic takes care of that */
+	printf(_("qdisc rate %.0f pkt/s  %.0f bit/s  dropped %.0f/s  overlimits %.0f/s  requeues %.0f/s\n"),
+	       qdisc_delta(c->packets, p->packets) / dt,
+	       (c->bytes - p->bytes) * 8 / dt,
+	       (unsigned int)(c->drops - p->drops) / dt,
+	       (unsigned int)(c->overlimits - p->overlimits) / dt,
+	       (unsigned int)(c->requeues - p->requeues) / dt);
+    } else {
+	printf(_("qdisc sent %llu packets %llu bytes  dropped %u  overlimits %u  requeues %u\n"),
+	       c->packets, c->bytes, c->drops, c->overlimits, c->requeues);
+    }
+}
+
+#if HAVE_AFINET
+static void ife_print_inet(struct aftype *ap, int flags, struct sockaddr *addr,
+			   struct sockaddr *netmask, struct sockaddr *broadaddr,
+			   struct sockaddr *dstaddr)
+{
+    printf(_("        %s %s"), ap->name, ap->sprint(addr, 1));
+    printf(_("  netmask %s"), ap->sprint(netmask, 1));
+    if (flags & IFF_BROADCAST) {
+	printf(_("  broadcast %s"), ap->sprint(broadaddr, 1));
+    }
+    if (flags & IFF_POINTOPOINT) {
+	printf(_("  destination %s"), ap->sprint(dstaddr, 1));
+    }
+    printf("\n");
+}
+#endif
+
+#if HAVE_AFINET6
+static void ife_print_inet6(struct sockaddr *sap, int plen, int scope)
+{
+    extern struct aftype inet6_aftype;
+    char flags[64];
+
+    printf(_("        %s %s  prefixlen %d"),
+	    inet6_aftype.name,
+	    inet6_aftype.sprint(sap, 1),
+	    plen);
+    printf(_("  scopeid 0x%x"), scope);
+
+    flags[0] = '<'; flags[1] = 0;
+    if (scope & IPV6_ADDR_COMPATv4) {
+	    strcat(flags, _("compat,"));
+	    scope -= IPV6_ADDR_COMPATv4;
+    }
+    if (scope == 0)
+	    strcat(flags, _("global,"));
+    if (scope & IPV6_ADDR_LINKLOCAL)
+	    strcat(flags, _("link,"));
+    if (scope & IPV6_ADDR_SITELOCAL)
+	    strcat(flags, _("site,"));
+    if (scope & IPV6_ADDR_LOOPBACK)
+	    strcat(flags, _("host,"));
+    if (flags[strlen(flags)-1] == ',')
+	    flags[strlen(flags)-1] = '>';
+    else
+	    flags[strlen(flags)-1] = 0;
+    printf("%s\n", flags);
+}
+#endif
+
 void ife_print_long(struct interface *ptr)
 {
     struct aftype *ap;
@@ -733,6 +1445,7 @@ void ife_print_long(struct interface *ptr)
     extern struct aftype inet6_aftype;
     char addr6p[8][5];
 #endif
+    struct interface_addr *ia;
 
     ap = get_afntype(ptr->addr.sa_family);
     if (ap == NULL)
@@ -803,23 +1516,22 @@ void ife_print_long(struct interface *ptr)
 
 #if HAVE_AFINET
     if (ptr->has_ip) {
-	printf(_("        %s %s"), ap->name,
-	       ap->sprint(&ptr->addr, 1));
-	printf(_("  netmask %s"), ap->sprint(&ptr->netmask, 1));
-	if (ptr->flags & IFF_BROADCAST) {
-	    printf(_("  broadcast %s"), ap->sprint(&ptr->broadaddr, 1));
-	}
-	if (ptr->flags & IFF_POINTOPOINT) {
-	    printf(_("  destination %s"), ap->sprint(&ptr->dstaddr, 1));
-	}
-	printf("\n");
+	ife_print_inet(ap, ptr->flags, &ptr->addr, &ptr->netmask,
+		       &ptr->broadaddr, &ptr->dstaddr);
+	for (ia = ptr->addrs; ia; ia = ia->next)
+	    if (ia->family == AF_INET)
+		ife_print_inet(ap, ptr->flags, (struct sockaddr *) &ia->addr,
+			       &ia->netmask, &ia->broadaddr, &ia->dstaddr);
     }
 #endif
 
 #if HAVE_AFINET6
-    /* FIXME: should be integrated into interface.c.   */
-
-    if ((f = fopen(_PATH_PROCNET_IFINET6, "r")) != NULL) {
+    if (ptr->netlink) {
+	for (ia = ptr->addrs; ia; ia = ia->next)
+	    if (ia->family == AF_INET6)
+		ife_print_inet6((struct sockaddr *) &ia->addr,
+				ia->prefixlen, ia->scope);
+    } else if ((f = fopen(_PATH_PROCNET_IFINET6, "r")) != NULL) {
 	while (fscanf(f, "%4s%4s%4s%4s%4s%4s%4s%4s %08x %02x %02x %02x %20s\n",
 		      addr6p[0], addr6p[1], addr6p[2], addr6p[3],
 		      addr6p[4], addr6p[5], addr6p[6], addr6p[7],
@@ -829,30 +1541,7 @@ void ife_print_long(struct interface *ptr)
 			addr6p[0], addr6p[1], addr6p[2], addr6p[3],
 			addr6p[4], addr6p[5], addr6p[6], addr6p[7]);
 		inet6_aftype.input(1, addr6, (struct sockaddr *) &sap);
-		printf(_("        %s %s  prefixlen %d"),
-			inet6_aftype.name,
-			inet6_aftype.sprint((struct sockaddr *) &sap, 1),
-			plen);
-		printf(_("  scopeid 0x%x"), scope);
-
-		flags[0] = '<'; flags[1] = 0;
-		if (scope & IPV6_ADDR_COMPATv4) {
-		    	strcat(flags, _("compat,"));
-		    	scope -= IPV6_ADDR_COMPATv4;
-		}
-		if (scope == 0)
-			strcat(flags, _("global,"));
-		if (scope & IPV6_ADDR_LINKLOCAL)
-			strcat(flags, _("link,"));
-		if (scope & IPV6_ADDR_SITELOCAL)
-			strcat(flags, _("site,"));
-		if (scope & IPV6_ADDR_LOOPBACK)
-			strcat(flags, _("host,"));
-		if (flags[strlen(flags)-1] == ',')
-			flags[strlen(flags)-1] = '>';
-		else
-			flags[strlen(flags)-1] = 0;
-		printf("%s\n", flags);
+		ife_print_inet6((struct sockaddr *) &sap, plen, scope);
 	    }
 	}
 	fclose(f);
@@ -969,12 +1658,20 @@ void ife_print_long(struct interface *ptr)
 	       (unsigned long)(short_rx % 10), Rext);
 	if (can_compress) {
   	    printf("        ");
-	    printf(_("RX compressed:%lu\n"), ptr->stats.rx_compressed);
+	    printf(_("RX compressed:%llu\n"), ptr->stats.rx_compressed);
 	}
 	printf("        ");
-	printf(_("RX errors %lu  dropped %lu  overruns %lu  frame %lu\n"),
+	printf(_("RX errors %llu  dropped %llu  overruns %llu  frame %llu\n"),
 	       ptr->stats.rx_errors, ptr->stats.rx_dropped,
 	       ptr->stats.rx_fifo_errors, ptr->stats.rx_frame_errors);
+	/* finer grained drops, only when there are any */
+	if (ptr->stats.rx_missed_errors || ptr->stats.rx_nohandler ||
+	    ptr->stats.rx_otherhost_dropped) {
+	    printf("        ");
+	    printf(_("RX missed %llu  nohandler %llu  otherhost %llu\n"),
+		   ptr->stats.rx_missed_errors, ptr->stats.rx_nohandler,
+		   ptr->stats.rx_otherhost_dropped);
+	}
 
 
 	printf("        ");
@@ -984,15 +1681,22 @@ void ife_print_long(struct interface *ptr)
 	        (unsigned long)(short_tx % 10), Text);
 	if (can_compress) {
   	    printf("        ");
-	    printf(_("TX compressed %lu\n"), ptr->stats.tx_compressed);
+	    printf(_("TX compressed %llu\n"), ptr->stats.tx_compressed);
 	}
 	printf("        ");
-	printf(_("TX errors %lu  dropped %lu overruns %lu  carrier %lu  collisions %lu\n"),
+	printf(_("TX errors %llu  dropped %llu overruns %llu  carrier %llu  collisions %llu\n"),
 	       ptr->stats.tx_errors,
 	       ptr->stats.tx_dropped, ptr->stats.tx_fifo_errors,
 	       ptr->stats.tx_carrier_errors, ptr->stats.collisions);
     }
 
+    {
+	struct interface_qdisc *qd;
+
+	for (qd = ptr->qdiscs; qd; qd = qd->next)
+	    ife_print_qdisc(qd);
+    }
+
     if ((ptr->map.irq || ptr->map.mem_start || ptr->map.dma ||
 	 ptr->map.base_addr >= 0x100)) {
 	printf("        device ");
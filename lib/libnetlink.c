@@ -0,0 +1,437 @@
+/*
+ * libnetlink.c	RTnetlink service routines.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ *
+ * Authors:	Alexey Kuznetsov, <kuznet@ms2.inr.ac.ru>
+ *
+ *		Trimmed down for net-tools: the tools only need to open a
+ *		socket, dump a table and walk the attributes.  All functions
+ *		return -1 with errno set instead of printing, so that callers
+ *		can quietly fall back to /proc and ioctls.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "libnetlink.h"
+
+/* Dump messages are built by the kernel to fit the largest buffer we
+   ever passed to recvmsg, never more than 32k. */
+#define RTNL_RCVBUF	(64*1024)
+
+void rtnl_close(struct rtnl_handle *rth)
+{
+	if (rth->fd >= 0) {
+		close(rth->fd);
+		rth->fd = -1;
+	}
+}
+
+int rtnl_open(struct rtnl_handle *rth, unsigned subscriptions)
+{
+	socklen_t addr_len;
+	int sndbuf = 32768;
+	int rcvbuf = 1024 * 1024;
+
+	memset(rth, 0, sizeof(*rth));
+
+	rth->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (rth->fd < 0)
+		return -1;
+
+	setsockopt(rth->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	setsockopt(rth->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	rth->local.nl_family = AF_NETLINK;
+	rth->local.nl_groups = subscriptions;
+
+	if (bind(rth->fd, (struct sockaddr *)&rth->local, sizeof(rth->local)) < 0)
+		goto fail;
+	addr_len = sizeof(rth->local);
+	if (getsockname(rth->fd, (struct sockaddr *)&rth->local, &addr_len) < 0)
+		goto fail;
+	if (addr_len != sizeof(rth->local) || rth->local.nl_family != AF_NETLINK) {
+		errno = EINVAL;
+		goto fail;
+	}
+	rth->seq = time(NULL);
+	return 0;
+
+fail:
+	rtnl_close(rth);
+	return -1;
+}
+
+int rtnl_wilddump_request(struct rtnl_handle *rth, int family, int type)
+{
+	struct rtgenmsg g;
+
+	memset(&g, 0, sizeof(g));
+	g.rtgen_family = family;
+	return rtnl_dump_request(rth, type, &g, sizeof(g));
+}
+
+int rtnl_dump_request(struct rtnl_handle *rth, int type, void *req, int len)
+{
+	struct nlmsghdr nlh;
+	struct sockaddr_nl nladdr;
+	struct iovec iov[2] = {
+		{ .iov_base = &nlh, .iov_len = sizeof(nlh) },
+		{ .iov_base = req, .iov_len = len }
+	};
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = iov,
+		.msg_iovlen = 2,
+	};
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+
+	nlh.nlmsg_len = NLMSG_LENGTH(len);
+	nlh.nlmsg_type = type;
+	nlh.nlmsg_flags = NLM_F_ROOT | NLM_F_MATCH | NLM_F_REQUEST;
+	nlh.nlmsg_pid = 0;
+	nlh.nlmsg_seq = rth->dump = ++rth->seq;
+
+	return sendmsg(rth->fd, &msg, 0);
+}
+
+/* Feed every message of the running dump to filter.  A negative return
+   from the filter stops the walk and is passed on. */
+int rtnl_dump_filter(struct rtnl_handle *rth, rtnl_filter_t filter, void *arg)
+{
+	struct sockaddr_nl nladdr;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	char *buf;
+	int err = 0;
+
+	buf = malloc(RTNL_RCVBUF);
+	if (!buf)
+		return -1;
+	iov.iov_base = buf;
+
+	while (1) {
+		int status;
+		struct nlmsghdr *h;
+
+		iov.iov_len = RTNL_RCVBUF;
+		status = recvmsg(rth->fd, &msg, 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			err = -1;
+			break;
+		}
+		if (status == 0 || (msg.msg_flags & MSG_TRUNC)) {
+			errno = EIO;
+			err = -1;
+			break;
+		}
+
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, status);
+		     h = NLMSG_NEXT(h, status)) {
+			if (nladdr.nl_pid != 0 ||
+			    h->nlmsg_pid != rth->local.nl_pid ||
+			    h->nlmsg_seq != rth->dump)
+				continue;
+
+			if (h->nlmsg_type == NLMSG_DONE)
+				goto out;
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				struct nlmsgerr *e = (struct nlmsgerr *)NLMSG_DATA(h);
+				errno = EIO;
+				if (h->nlmsg_len >= NLMSG_LENGTH(sizeof(*e)))
+					errno = -e->error;
+				err = -1;
+				goto out;
+			}
+			err = filter(h, arg);
+			if (err < 0)
+				goto out;
+		}
+	}
+out:
+	free(buf);
+	return err < 0 ? err : 0;
+}
+
+/* Hand every notification arriving on a subscribed socket to handler,
+   until it returns a negative value.  If the receive buffer overran,
+   notifications were lost: -1 with errno ENOBUFS, after which the
+   caller should dump what it watches again and come back.  On a socket
+   with a receive timeout, -1 with errno EAGAIN when it expired. */
+int rtnl_listen(struct rtnl_handle *rth, rtnl_filter_t handler, void *arg)
+{
+	struct sockaddr_nl nladdr;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	char *buf;
+	int err = 0;
+
+	buf = malloc(RTNL_RCVBUF);
+	if (!buf)
+		return -1;
+	iov.iov_base = buf;
+
+	while (err >= 0) {
+		int status;
+		struct nlmsghdr *h;
+
+		iov.iov_len = RTNL_RCVBUF;
+		status = recvmsg(rth->fd, &msg, 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			err = -1;
+			break;
+		}
+		if (status == 0) {
+			errno = EIO;
+			err = -1;
+			break;
+		}
+		/* only the kernel is trusted to tell about changes */
+		if (nladdr.nl_pid != 0)
+			continue;
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, status);
+		     h = NLMSG_NEXT(h, status)) {
+			if (h->nlmsg_type == NLMSG_ERROR ||
+			    h->nlmsg_type == NLMSG_DONE ||
+			    h->nlmsg_type == NLMSG_NOOP)
+				continue;
+			err = handler(h, arg);
+			if (err < 0)
+				break;
+		}
+	}
+	free(buf);
+	return err;
+}
+
+/* Throw away the notifications queued on the socket.  After an overrun
+   they are stale: a dump taken afterwards already has their effect. */
+void rtnl_drain(struct rtnl_handle *rth)
+{
+	char buf[8192];
+
+	for (;;) {
+		if (recv(rth->fd, buf, sizeof(buf), MSG_DONTWAIT) >= 0)
+			continue;
+		if (errno != EINTR && errno != ENOBUFS)
+			break;
+	}
+}
+
+/* Batches are kept well below the socket receive buffer, so that the
+   error replies of a batch in which every request failed still fit. */
+#define RTNL_BATCH_SIZE	(32*1024)
+
+int rtnl_batch_init(struct rtnl_batch *b, struct rtnl_handle *rth,
+		    int max, rtnl_error_t error, void *arg)
+{
+	memset(b, 0, sizeof(*b));
+	b->max = max > 0 ? max : 256;
+	b->buf = malloc(RTNL_BATCH_SIZE);
+	b->tag = malloc(b->max * sizeof(*b->tag));
+	if (!b->buf || !b->tag) {
+		rtnl_batch_free(b);
+		return -1;
+	}
+	b->rth = rth;
+	b->size = RTNL_BATCH_SIZE;
+	b->error = error;
+	b->arg = arg;
+	return 0;
+}
+
+void rtnl_batch_free(struct rtnl_batch *b)
+{
+	free(b->buf);
+	free(b->tag);
+	b->buf = NULL;
+	b->tag = NULL;
+}
+
+/* Queue a copy of n.  Errors are reported with tag, which can be
+   anything the caller can trace a request back to (a line number, say).
+   Returns the number of failed requests if a full batch had to be sent
+   first. */
+int rtnl_batch_add(struct rtnl_batch *b, struct nlmsghdr *n, __u32 tag)
+{
+	struct nlmsghdr *h;
+	int err = 0;
+
+	if (b->count >= b->max || b->len + NLMSG_ALIGN(n->nlmsg_len) > b->size) {
+		err = rtnl_batch_flush(b);
+		if (err < 0)
+			return err;
+	}
+	if (NLMSG_ALIGN(n->nlmsg_len) > b->size) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	if (b->count == 0)
+		b->first = b->rth->seq + 1;
+	h = (struct nlmsghdr *)(b->buf + b->len);
+	memcpy(h, n, n->nlmsg_len);
+	h->nlmsg_flags = (n->nlmsg_flags | NLM_F_REQUEST) & ~NLM_F_ACK;
+	h->nlmsg_seq = ++b->rth->seq;
+	h->nlmsg_pid = 0;
+	b->tag[b->count++] = tag;
+	b->tail = b->len;
+	b->len += NLMSG_ALIGN(n->nlmsg_len);
+	return err;
+}
+
+/* Send the queued requests and wait until the kernel is through with
+   them.  Only the last one asks for an ACK; the kernel handles the
+   requests of one sendmsg in order, so that ACK means all are done and
+   every other reply is an error.  Returns the number of failures. */
+int rtnl_batch_flush(struct rtnl_batch *b)
+{
+	struct sockaddr_nl nladdr;
+	struct nlmsghdr *last;
+	struct iovec iov;
+	struct msghdr msg = {
+		.msg_name = &nladdr,
+		.msg_namelen = sizeof(nladdr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	char *buf;
+	__u32 lastseq;
+	int failed = 0, done = 0, count = b->count;
+
+	if (count == 0)
+		return 0;
+
+	last = (struct nlmsghdr *)(b->buf + b->tail);
+	last->nlmsg_flags |= NLM_F_ACK;
+	lastseq = last->nlmsg_seq;
+
+	memset(&nladdr, 0, sizeof(nladdr));
+	nladdr.nl_family = AF_NETLINK;
+	iov.iov_base = b->buf;
+	iov.iov_len = b->len;
+	b->len = b->count = 0;
+	if (sendmsg(b->rth->fd, &msg, 0) < 0)
+		return -1;
+
+	buf = malloc(RTNL_RCVBUF);
+	if (!buf)
+		return -1;
+	iov.iov_base = buf;
+
+	while (!done) {
+		struct nlmsghdr *h;
+		int status;
+
+		iov.iov_len = RTNL_RCVBUF;
+		status = recvmsg(b->rth->fd, &msg, 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			failed = -1;
+			break;
+		}
+		if (status == 0) {
+			errno = EIO;
+			failed = -1;
+			break;
+		}
+		for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, status);
+		     h = NLMSG_NEXT(h, status)) {
+			struct nlmsgerr *e = (struct nlmsgerr *)NLMSG_DATA(h);
+
+			if (nladdr.nl_pid != 0 ||
+			    h->nlmsg_pid != b->rth->local.nl_pid ||
+			    h->nlmsg_type != NLMSG_ERROR ||
+			    h->nlmsg_len < NLMSG_LENGTH(sizeof(*e)) ||
+			    h->nlmsg_seq - b->first >= (__u32)count)
+				continue;
+			if (e->error) {
+				failed++;
+				if (b->error)
+					b->error(b->tag[h->nlmsg_seq - b->first],
+						 -e->error, b->arg);
+			}
+			if (h->nlmsg_seq == lastseq)
+				done = 1;
+		}
+	}
+	free(buf);
+	return failed;
+}
+
+int addattr32(struct nlmsghdr *n, int maxlen, int type, __u32 data)
+{
+	return addattr_l(n, maxlen, type, &data, sizeof(data));
+}
+
+int addattr_l(struct nlmsghdr *n, int maxlen, int type, const void *data, int alen)
+{
+	int len = RTA_LENGTH(alen);
+	struct rtattr *rta;
+
+	if (NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(len) > maxlen) {
+		errno = ENOSPC;
+		return -1;
+	}
+	rta = (struct rtattr *)(((char *)n) + NLMSG_ALIGN(n->nlmsg_len));
+	rta->rta_type = type;
+	rta->rta_len = len;
+	memcpy(RTA_DATA(rta), data, alen);
+	n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + RTA_ALIGN(len);
+	return 0;
+}
+
+/* Append to a nested attribute built in a separate buffer. */
+int rta_addattr32(struct rtattr *rta, int maxlen, int type, __u32 data)
+{
+	int len = RTA_LENGTH(4);
+	struct rtattr *sub;
+
+	if (RTA_ALIGN(rta->rta_len) + len > maxlen) {
+		errno = ENOSPC;
+		return -1;
+	}
+	sub = (struct rtattr *)(((char *)rta) + RTA_ALIGN(rta->rta_len));
+	sub->rta_type = type;
+	sub->rta_len = len;
+	memcpy(RTA_DATA(sub), &data, 4);
+	rta->rta_len = RTA_ALIGN(rta->rta_len) + len;
+	return 0;
+}
+
+int parse_rtattr(struct rtattr *tb[], int max, struct rtattr *rta, int len)
+{
+	memset(tb, 0, sizeof(struct rtattr *) * (max + 1));
+	while (RTA_OK(rta, len)) {
+		if (rta->rta_type <= max)
+			tb[rta->rta_type] = rta;
+		rta = RTA_NEXT(rta, len);
+	}
+	return 0;
+}
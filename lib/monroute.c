@@ -0,0 +1,494 @@
+/*
+ * lib/monroute.c	Follow routing table changes as rtnetlink reports
+ *			them, for "route monitor" and "netstat -r --watch".
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		Every RTM_NEWROUTE/RTM_DELROUTE notification is printed as
+ *		one timestamped row in the columns of the table listing.
+ *		With a summary interval a copy of the tables is kept up to
+ *		date from the same notifications, so that the counts in the
+ *		summary come for free and an overrun of the socket buffer
+ *		can be repaired by comparing a fresh dump with the copy.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <net/route.h>
+#include "config.h"
+#include "net-support.h"
+#include "intl.h"
+#include "util.h"
+#include "libnetlink.h"
+#include "fib.h"
+
+#ifndef RTF_CACHE
+#define RTF_CACHE	0x01000000
+#endif
+
+/* Routes are told apart per next hop, like the rows of the listing.
+   Everything before gw is what the kernel matches on for replace;
+   siblings with the same prefix of the key share a hash chain, so a
+   replace can find the routes it supersedes. */
+struct mon_key {
+    unsigned int table;
+    unsigned int metric;
+    unsigned char family;
+    unsigned char dst_len;
+    unsigned char tos;
+    unsigned char dst[16];
+    unsigned char gw[16];
+    char iface[IFNAMSIZ];
+};
+
+struct mon_route {
+    struct mon_route *next;
+    struct mon_key key;
+    union {
+	struct fib4_entry e4;
+	struct fib6_entry e6;
+    } u;
+    long seq;			/* kernel order among its siblings */
+    int seen;
+};
+
+struct mon_count {
+    unsigned long routes;
+    unsigned long add, del, replace;
+};
+
+struct mon_ctx {
+    int ext, numeric;
+    int v4, v6;
+    int table4, table6;
+    int show_table;
+    int head4, head6;
+    int keep;			/* keep a copy of the tables */
+    int quiet;			/* initial dump, nothing to report */
+    struct mon_route **hash;
+    unsigned int size;
+    long first, last;		/* seq before and after all others */
+    struct mon_count c4, c6;
+    int interval;		/* seconds between summaries, 0 for none */
+    time_t next;		/* when the next summary is due */
+};
+
+static unsigned int mon_hash(const struct mon_key *k, unsigned int size)
+{
+    /* everything up to the gateway */
+    return fnv_hash(FNV_INIT, k, offsetof(struct mon_key, gw)) & (size - 1);
+}
+
+static void mon_grow(struct mon_ctx *m)
+{
+    struct mon_route **old = m->hash, *r, *rn;
+    unsigned int i, osize = m->size;
+
+    m->size = osize ? osize * 2 : 1024;
+    m->hash = xmalloc(m->size * sizeof(*m->hash));
+    memset(m->hash, 0, m->size * sizeof(*m->hash));
+    for (i = 0; i < osize; i++)
+	for (r = old[i]; r; r = rn) {
+	    unsigned int h = mon_hash(&r->key, m->size);
+
+	    rn = r->next;
+	    r->next = m->hash[h];
+	    m->hash[h] = r;
+	}
+    free(old);
+}
+
+static struct mon_route **mon_find(struct mon_ctx *m, const struct mon_key *k)
+{
+    struct mon_route **pp;
+
+    for (pp = &m->hash[mon_hash(k, m->size)]; *pp; pp = &(*pp)->next)
+	if (!memcmp(&(*pp)->key, k, sizeof(*k)))
+	    break;
+    return pp;
+}
+
+static struct mon_count *mon_count(struct mon_ctx *m, int family)
+{
+    return family == AF_INET ? &m->c4 : &m->c6;
+}
+
+static void mon_row(struct mon_ctx *m, const char *event, int family,
+		    const void *e)
+{
+    char ts[40];
+
+    if (m->quiet)
+	return;
+    if (family == AF_INET && !m->head4) {
+	printf("%-26s %-7s ", _("Time"), _("Event"));
+	if (m->show_table)
+	    printf("%-8s ", _("Table"));
+	fib4_print_head(m->ext);
+	m->head4 = 1;
+    }
+    if (family == AF_INET6 && !m->head6) {
+	printf("%-26s %-7s ", _("Time"), _("Event"));
+	if (m->show_table)
+	    printf("%-8s ", _("Table"));
+	fib6_print_head();
+	m->head6 = 1;
+    }
+    printf("%-26s %-7s ", format_timestamp(ts, sizeof(ts)), event);
+    if (m->show_table)
+	printf("%-8s ", route_table_name(family == AF_INET ?
+		((const struct fib4_entry *) e)->table :
+		((const struct fib6_entry *) e)->table));
+    if (family == AF_INET)
+	fib4_print(stdout, e, m->ext, m->numeric);
+    else
+	fib6_print(stdout, e, m->numeric);
+    fflush(stdout);
+}
+
+/* Apply one route to the copy of the tables; returns the event to
+   print, or NULL when nothing changed.  flags are those of the
+   notification. */
+static const char *mon_apply(struct mon_ctx *m, int type, int flags,
+			     const struct mon_key *k, int family, const void *e)
+{
+    struct mon_count *c = mon_count(m, family);
+    struct mon_route **pp, *r, **victim = NULL;
+    size_t len = family == AF_INET ? sizeof(r->u.e4) : sizeof(r->u.e6);
+    long seq = 0;
+    int replaced = 0;
+
+    if (!m->keep) {
+	if (type == RTM_DELROUTE) {
+	    c->del++;
+	    return _("del");
+	}
+	if (flags & NLM_F_REPLACE) {
+	    c->replace++;
+	    return _("replace");
+	}
+	c->add++;
+	return _("add");
+    }
+
+    /* IPv6 drops the other hops of the replaced route without a
+       notification, IPv4 replaces the first of its siblings only */
+    if (type == RTM_NEWROUTE && (flags & NLM_F_REPLACE)) {
+	for (pp = &m->hash[mon_hash(k, m->size)]; (r = *pp) != NULL; ) {
+	    if (memcmp(&r->key, k, offsetof(struct mon_key, gw))) {
+		pp = &r->next;
+		continue;
+	    }
+	    if (family == AF_INET6 && memcmp(&r->key, k, sizeof(*k))) {
+		*pp = r->next;
+		free(r);
+		c->routes--;
+		continue;
+	    }
+	    if (family == AF_INET && (!victim || r->seq < (*victim)->seq))
+		victim = pp;
+	    pp = &r->next;
+	}
+	if (victim && memcmp(&(*victim)->key, k, sizeof(*k))) {
+	    r = *victim;
+	    *victim = r->next;
+	    seq = r->seq;
+	    free(r);
+	    c->routes--;
+	    replaced = 1;
+	}
+    }
+    pp = mon_find(m, k);
+    if (type == RTM_DELROUTE) {
+	if (!(r = *pp))
+	    return NULL;
+	*pp = r->next;
+	free(r);
+	c->routes--;
+	c->del++;
+	return _("del");
+    }
+    if ((r = *pp) != NULL) {
+	r->seen = 1;
+	/* a dump lists siblings in kernel order */
+	if (flags & NLM_F_MULTI)
+	    r->seq = ++m->last;
+	if (!memcmp(&r->u, e, len))
+	    return NULL;
+	memcpy(&r->u, e, len);
+	c->replace++;
+	return _("replace");
+    }
+    r = xmalloc(sizeof(*r));
+    r->key = *k;
+    memcpy(&r->u, e, len);
+    r->seen = 1;
+    /* without NLM_F_APPEND the kernel puts a route before its siblings */
+    if (replaced)
+	r->seq = seq;
+    else if (flags & (NLM_F_APPEND | NLM_F_MULTI))
+	r->seq = ++m->last;
+    else
+	r->seq = --m->first;
+    r->next = *pp;
+    *pp = r;
+    c->routes++;
+    if (m->c4.routes + m->c6.routes > 2 * m->size)
+	mon_grow(m);
+    if (replaced) {
+	c->replace++;
+	return _("replace");
+    }
+    if (!m->quiet)
+	c->add++;
+    return _("add");
+}
+
+static int mon_msg(struct nlmsghdr *n, void *arg)
+{
+    struct mon_ctx *m = arg;
+    struct rtmsg *r = NLMSG_DATA(n);
+    struct mon_key k;
+    const char *ev;
+
+    if (n->nlmsg_type != RTM_NEWROUTE && n->nlmsg_type != RTM_DELROUTE)
+	return 0;
+    if (n->nlmsg_len < NLMSG_LENGTH(sizeof(*r)))
+	return 0;
+
+    if (r->rtm_family == AF_INET && m->v4) {
+	struct fib4_entry e;
+
+	if (!fib4_parse(n, &e))
+	    return 0;
+	if (m->table4 != RT_TABLE_UNSPEC && e.table != m->table4)
+	    return 0;
+	memset(&k, 0, sizeof(k));
+	k.family = AF_INET;
+	k.table = e.table;
+	k.metric = e.metric;
+	k.dst_len = e.dst_len;
+	k.tos = e.tos;
+	memcpy(k.dst, &e.dst, 4);
+	memcpy(k.gw, &e.gw, 4);
+	safe_strncpy(k.iface, e.iface, sizeof(k.iface));
+	if ((ev = mon_apply(m, n->nlmsg_type, n->nlmsg_flags, &k, AF_INET, &e)))
+	    mon_row(m, ev, AF_INET, &e);
+    }
+    if (r->rtm_family == AF_INET6 && m->v6) {
+	struct fib6_entry e;
+	int hops, i;
+
+	for (i = 0, hops = 1; i < hops; i++) {
+	    if (!(hops = fib6_parse(n, &e, i)))
+		return 0;
+	    if (e.flags & RTF_CACHE)
+		return 0;
+	    if (m->table6 != RT_TABLE_UNSPEC && e.table != m->table6)
+		return 0;
+	    memset(&k, 0, sizeof(k));
+	    k.family = AF_INET6;
+	    k.table = e.table;
+	    k.metric = e.metric;
+	    k.dst_len = e.dst_len;
+	    memcpy(k.dst, &e.dst, 16);
+	    memcpy(k.gw, &e.gw, 16);
+	    safe_strncpy(k.iface, e.iface, sizeof(k.iface));
+	    /* only the first hop replaces its siblings */
+	    if ((ev = mon_apply(m, n->nlmsg_type,
+				i ? n->nlmsg_flags & ~NLM_F_REPLACE : n->nlmsg_flags,
+				&k, AF_INET6, &e)))
+		mon_row(m, ev, AF_INET6, &e);
+	}
+    }
+    return 0;
+}
+
+/* Dump the tables we watch and report whatever differs from the copy,
+   including routes that are gone. */
+static int mon_dump(struct mon_ctx *m)
+{
+    struct rtnl_handle rth;
+    struct mon_route **pp, *r;
+    unsigned int h;
+    int err = -1;
+
+    for (h = 0; h < m->size; h++)
+	for (r = m->hash[h]; r; r = r->next)
+	    r->seen = 0;
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    if (m->v4 && (rtnl_wilddump_request(&rth, AF_INET, RTM_GETROUTE) < 0 ||
+		  rtnl_dump_filter(&rth, mon_msg, m) < 0))
+	goto out;
+    if (m->v6 && (rtnl_wilddump_request(&rth, AF_INET6, RTM_GETROUTE) < 0 ||
+		  rtnl_dump_filter(&rth, mon_msg, m) < 0))
+	goto out;
+    err = 0;
+
+    for (h = 0; h < m->size; h++)
+	for (pp = &m->hash[h]; (r = *pp) != NULL; ) {
+	    struct mon_count *c = mon_count(m, r->key.family);
+
+	    if (r->seen) {
+		pp = &r->next;
+		continue;
+	    }
+	    mon_row(m, _("del"), r->key.family, &r->u);
+	    c->routes--;
+	    c->del++;
+	    *pp = r->next;
+	    free(r);
+	}
+out:
+    rtnl_close(&rth);
+    return err;
+}
+
+static void mon_summary(struct mon_ctx *m)
+{
+    char ts[40];
+
+    printf("%-26s %-7s", format_timestamp(ts, sizeof(ts)), _("summary"));
+    if (m->v4)
+	printf(_(" IPv4 %lu routes (+%lu -%lu ~%lu)"), m->c4.routes,
+	       m->c4.add, m->c4.del, m->c4.replace);
+    if (m->v6)
+	printf(_(" IPv6 %lu routes (+%lu -%lu ~%lu)"), m->c6.routes,
+	       m->c6.add, m->c6.del, m->c6.replace);
+    printf("\n");
+    m->c4.add = m->c4.del = m->c4.replace = 0;
+    m->c6.add = m->c6.del = m->c6.replace = 0;
+}
+
+/* Print the summary when it is due.  A busy table may never leave the
+   socket idle long enough for the receive timeout, so this runs after
+   every notification as well. */
+static void mon_tick(struct mon_ctx *m)
+{
+    time_t now;
+
+    if (m->interval <= 0 || (now = time(NULL)) < m->next)
+	return;
+    mon_summary(m);
+    m->next = now + m->interval;
+    fflush(stdout);
+}
+
+static int mon_listen(struct nlmsghdr *n, void *arg)
+{
+    int err = mon_msg(n, arg);
+
+    mon_tick(arg);
+    return err;
+}
+
+/* Print route changes of the address families in afname until killed.
+   With interval > 0 a summary line follows every interval seconds. */
+int route_monitor(const char *afname, int options, int interval)
+{
+    struct rtnl_handle rth;
+    struct mon_ctx m;
+    struct timeval tv;
+    char buf[256], *tmp1, *tmp2;
+    unsigned int groups = 0;
+
+    memset(&m, 0, sizeof(m));
+    safe_strncpy(buf, afname, sizeof(buf));
+    for (tmp1 = buf; tmp1; tmp1 = tmp2) {
+	if ((tmp2 = strchr(tmp1, ',')))
+	    *tmp2++ = '\0';
+	if (!tmp1[0])
+	    continue;
+#if HAVE_AFINET
+	if (!strcmp(tmp1, "inet")) {
+	    m.v4 = 1;
+	    groups |= RTMGRP_IPV4_ROUTE;
+	    continue;
+	}
+#endif
+#if HAVE_AFINET6
+	if (!strcmp(tmp1, "inet6")) {
+	    m.v6 = 1;
+	    groups |= RTMGRP_IPV6_ROUTE;
+	    continue;
+	}
+#endif
+	fprintf(stderr, _("No route monitor for address family `%s'.\n"), tmp1);
+	return E_OPTERR;
+    }
+    if (!groups)
+	return E_OPTERR;
+
+    m.ext = options & FLAG_EXT;
+    m.numeric = options & (FLAG_NUM_HOST | FLAG_SYM);
+    /* the same tables the listing shows */
+    m.table4 = route_table == FIB_TABLE_PROC ? RT_TABLE_MAIN : route_table;
+    m.table6 = route_table == FIB_TABLE_PROC ? RT_TABLE_UNSPEC : route_table;
+    m.show_table = route_table == RT_TABLE_UNSPEC;
+
+    /* subscribe before the dump, so nothing falls in between */
+    if (rtnl_open(&rth, groups) < 0) {
+	perror("rtnetlink");
+	return E_SOCK;
+    }
+    if (interval > 0) {
+	m.keep = 1;
+	mon_grow(&m);
+	m.quiet = 1;
+	if (mon_dump(&m) < 0) {
+	    perror("RTM_GETROUTE");
+	    rtnl_close(&rth);
+	    return E_SOCK;
+	}
+	m.quiet = 0;
+	mon_summary(&m);
+	/* wake up now and then to keep the summaries on time */
+	tv.tv_sec = 1;
+	tv.tv_usec = 0;
+	setsockopt(rth.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	m.interval = interval;
+	m.next = time(NULL) + interval;
+    }
+    fflush(stdout);
+
+    for (;;) {
+	if (rtnl_listen(&rth, mon_listen, &m) == 0)
+	    break;
+	if (errno == EAGAIN) {
+	    mon_tick(&m);
+	    fflush(stdout);
+	    continue;
+	}
+	if (errno != ENOBUFS) {
+	    perror("rtnetlink");
+	    break;
+	}
+	/* the kernel had to drop notifications */
+	printf(_("%-26s event queue overrun%s\n"), format_timestamp(buf, sizeof(buf)),
+	       m.keep ? _(", resyncing") : _(", events lost"));
+	rtnl_drain(&rth);
+	if (m.keep) {
+	    /* the rows up to "resync done" are what the dump found */
+	    if (mon_dump(&m) < 0)
+		perror("RTM_GETROUTE");
+	    printf(_("%-26s resync done\n"), format_timestamp(buf, sizeof(buf)));
+	}
+	fflush(stdout);
+    }
+    rtnl_close(&rth);
+    return E_SOCK;
+}
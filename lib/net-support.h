@@ -91,6 +91,8 @@ extern int activate_ld(const char *hwname, int fd);
 #define RTACTION_HELP  3
 #define RTACTION_FLUSH 4
 #define RTACTION_SHOW  5
+#define RTACTION_LOOKUP 6
+#define RTACTION_MONITOR 7
 
 #define FLAG_EXT       3		/* AND-Mask */
 #define FLAG_NUM_HOST  4
@@ -101,6 +103,7 @@ extern int activate_ld(const char *hwname, int fd);
 #define FLAG_CACHE    64
 #define FLAG_FIB     128
 #define FLAG_VERBOSE 256
+#define FLAG_PROC    512		/* read /proc, not rtnetlink */
 
 extern int ip_masq_info(int numeric_host, int numeric_port, int ext);
 
@@ -7,93 +7,63 @@
 #include "util.h"
 
 
-/* return numerical :999 suffix or null. sideeffect: replace ':' with \0 */
-char* cutalias(char* name)
+/*
+ * Split a name into the parts nstrcmp() compares: the text before a
+ * trailing number, the number and an optional ":999" alias suffix.
+ * Callers comparing the same names over and over (the interface cache)
+ * keep the key around instead of recomputing it.
+ */
+void nstrkey_init(struct nstrkey *k, const char *name)
 {
-	int digit = 0;
+	int len = strlen(name);
+	int end = len;
 	int pos;
 
-	for(pos=strlen(name); pos>0; pos--)
-	{
-		if (name[pos-1]==':' && digit)
-		{
-			name[pos-1]='\0';
-			return name+pos;
-		}
-		if (!isdigit(name[pos-1]))
-			break;
-		digit = 1;
+	k->alias = -1;
+	for (pos = len; pos > 0 && isdigit(name[pos-1]); pos--)
+		;
+	if (pos < len && pos > 0 && name[pos-1] == ':') {
+		k->alias = atoi(name + pos);
+		end = pos - 1;
 	}
-	return NULL;
-}
-
 
-/* return index of last non digit or -1 if it does not end with digits */
-int rindex_nondigit(char *name)
-{
-	int pos = strlen(name);
-
-	for(pos=strlen(name); pos>0; pos--)
-	{
-		if (!isdigit(name[pos-1]))
-			return pos;
-	}
-	return 0;
+	for (pos = end; pos > 0 && isdigit(name[pos-1]); pos--)
+		;
+	k->index = pos;
+	k->num = atoi(name + pos);
 }
 
 
-/* like strcmp(), but knows about numbers and ':' alias suffix */
-int nstrcmp(const char *ap, const char *bp)
+int nstrkey_cmp(const char *a, const struct nstrkey *ak,
+		const char *b, const struct nstrkey *bk)
 {
-	char *a = xstrdup(ap);
-	char *b = xstrdup(bp);
-	char *an, *bn;
-	int av = 0, bv = 0;
-	char *aalias=cutalias(a);
-	char *balias=cutalias(b);
-	int aindex=rindex_nondigit(a);
-	int bindex=rindex_nondigit(b);
-	int complen=(aindex<bindex)?aindex:bindex;
+	int complen = netmin(ak->index, bk->index);
 	int res = strncmp(a, b, complen);
 
 	if (res != 0)
-		{ free(a); free(b); return res; }
-
-	if (aindex > bindex)
-		{ free(a); free(b); return 1; }
-
-	if (aindex < bindex)
-		{ free(a); free(b); return -1; }
+		return res;
 
-	an = a+aindex;
-	bn = b+bindex;
+	if (ak->index != bk->index)
+		return ak->index > bk->index ? 1 : -1;
 
-	av = atoi(an);
-	bv = atoi(bn);
+	if (ak->num != bk->num)
+		return ak->num < bk->num ? -1 : 1;
 
-	if (av < bv)
-		{ free(a); free(b); return -1; }
+	if (ak->alias != bk->alias)
+		return ak->alias < bk->alias ? -1 : 1;
 
-	if (av > bv)
-		{ free(a); free(b); return 1; }
-
-	av = -1;
-	if (aalias != NULL)
-		av = atoi(aalias);
-
-	bv = -1;
-	if (balias != NULL)
-		bv = atoi(balias);
-
-	free(a); free(b);
+	return 0;
+}
 
-	if (av < bv)
-		return -1;
 
-	if (av > bv)
-		return 1;
+/* like strcmp(), but knows about numbers and ':' alias suffix */
+int nstrcmp(const char *a, const char *b)
+{
+	struct nstrkey ak, bk;
 
-	return 0;
+	nstrkey_init(&ak, a);
+	nstrkey_init(&bk, b);
+	return nstrkey_cmp(a, &ak, b, &bk);
 }
 
 
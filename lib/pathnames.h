@@ -55,6 +55,8 @@
 #define _PATH_PROCNET_ATALK_ROUTE	"/proc/net/atalk_route"
 #define _PATH_SYS_BLUETOOTH_L2CAP	"/sys/class/bluetooth/l2cap"
 #define _PATH_SYS_BLUETOOTH_RFCOMM	"/sys/class/bluetooth/rfcomm"
+#define _PATH_SYS_CLASS_NET		"/sys/class/net"
+#define _PATH_RT_TABLES			"/etc/iproute2/rt_tables"
 
 /* pathname for the netlink device */
 #define _PATH_DEV_ROUTE	"/dev/route"
@@ -26,11 +26,15 @@
  */
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
 #include "net-support.h"
 #include "pathnames.h"
 #include "version.h"
 #include "config.h"
 #include "intl.h"
+#include "libnetlink.h"
+#include "fib.h"
 
 extern struct aftype unspec_aftype;
 extern struct aftype unix_aftype;
@@ -86,3 +90,136 @@ int route_edit(int action, const char *afname, int options, char **argv)
     }
     return (ap->rinput(action, options, argv));
 }
+
+
+/* Start a route request for the table selected with -T (main by
+   default), with what "route add" got from SIOCADDRT. */
+struct rtmsg *route_rtnl_init(struct nlmsghdr *n, int maxlen, int action, int family)
+{
+    struct rtmsg *r = NLMSG_DATA(n);
+    int table = route_table == FIB_TABLE_PROC ? RT_TABLE_MAIN : route_table;
+
+    memset(n, 0, NLMSG_LENGTH(sizeof(*r)));
+    n->nlmsg_len = NLMSG_LENGTH(sizeof(*r));
+    n->nlmsg_flags = NLM_F_REQUEST;
+    r->rtm_family = family;
+    r->rtm_table = table < 256 ? table : RT_TABLE_UNSPEC;
+    if (action == RTACTION_ADD) {
+	n->nlmsg_type = RTM_NEWROUTE;
+	n->nlmsg_flags |= NLM_F_CREATE;
+	r->rtm_protocol = RTPROT_BOOT;
+	r->rtm_scope = RT_SCOPE_UNIVERSE;
+	r->rtm_type = RTN_UNICAST;
+    } else {
+	n->nlmsg_type = RTM_DELROUTE;
+	r->rtm_scope = RT_SCOPE_NOWHERE;
+    }
+    if (table >= 256)
+	addattr32(n, maxlen, RTA_TABLE, table);
+    return r;
+}
+
+static void route_batch_error(__u32 line, int err, void *arg)
+{
+    fprintf(stderr, _("route: %s:%u: %s\n"), (char *) arg, line, strerror(err));
+}
+
+/*
+ * route -f: every line of the file is an add or del command as given to
+ * route, with numeric addresses only.  The family follows the target
+ * (IPv6 if it has a colon, the -A family for "default").  Requests go
+ * out over one rtnetlink socket in batches; only failures come back,
+ * and they are reported with their line number.
+ */
+int route_batch(const char *file, const char *afname, int options)
+{
+    struct rtnl_handle rth;
+    struct rtnl_batch b;
+    struct {
+	struct nlmsghdr n;
+	struct rtmsg r;
+	char buf[256];
+    } req;
+    char buff[1024], *sp, *args[32], **ap, *target;
+    const char *err;
+    int linenr = 0, failed = 0, action, inet6, rc;
+    FILE *fp = stdin;
+
+    if (strcmp(file, "-") && (fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	return E_NOTFOUND;
+    }
+    if (rtnl_open(&rth, 0) < 0) {
+	perror("RTNETLINK");
+	return E_SOCK;
+    }
+    if (rtnl_batch_init(&b, &rth, 0, route_batch_error, (void *) file) < 0) {
+	perror("RTNETLINK");
+	rtnl_close(&rth);
+	return E_SOCK;
+    }
+
+    while (fgets(buff, sizeof(buff), fp) != NULL) {
+	linenr++;
+	if (options & FLAG_VERBOSE)
+	    fprintf(stderr, ">> %s", buff);
+	if ((sp = strchr(buff, '\n')) != NULL)
+	    *sp = '\0';
+	if (getargs(buff, args) == 0 || args[0][0] == '#' || args[0][0] == '\0')
+	    continue;
+	ap = args;
+	if (!strcmp(*ap, "route") && !*++ap)
+	    continue;
+
+	if (!strcmp(*ap, "add"))
+	    action = RTACTION_ADD;
+	else if (!strcmp(*ap, "del") || !strcmp(*ap, "delete"))
+	    action = RTACTION_DEL;
+	else {
+	    fprintf(stderr, _("route: %s:%d: %s\n"), file, linenr,
+		    _("only add and del are supported"));
+	    failed++;
+	    continue;
+	}
+	ap++;
+
+	target = *ap;
+	if (target && (!strcmp(target, "-net") || !strcmp(target, "-host")))
+	    target = ap[1];
+	inet6 = target && (strchr(target, ':') ||
+			   (!strcmp(target, "default") && !strcmp(afname, "inet6")));
+	err = _("address family not supported");
+#if HAVE_AFINET6
+	if (inet6)
+	    err = INET6_rtnl_route(action, ap, &req.n, sizeof(req));
+#endif
+#if HAVE_AFINET
+	if (!inet6)
+	    err = INET_rtnl_route(action, ap, &req.n, sizeof(req));
+#endif
+	if (err) {
+	    fprintf(stderr, _("route: %s:%d: %s\n"), file, linenr, err);
+	    failed++;
+	    continue;
+	}
+	if ((rc = rtnl_batch_add(&b, &req.n, linenr)) < 0) {
+	    perror("RTNETLINK");
+	    failed++;
+	    break;
+	}
+	failed += rc;
+    }
+    if ((rc = rtnl_batch_flush(&b)) < 0) {
+	perror("RTNETLINK");
+	failed++;
+    } else
+	failed += rc;
+
+    rtnl_batch_free(&b);
+    rtnl_close(&rth);
+    if (fp != stdin)
+	fclose(fp);
+    if ((options & FLAG_VERBOSE) && failed)
+	fprintf(stderr, _("WARNING: %d command(s) failed.\n"), failed);
+    return failed ? E_SOCK : 0;
+}
@@ -0,0 +1,428 @@
+/*
+ * lib/snaproute.c	Binary routing table snapshots for "route --save"
+ *			and "route --diff".
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		A snapshot is a short header and one fixed size record per
+ *		route (per next hop for IPv6), with every field in network
+ *		byte order so that files from different hosts compare.  The
+ *		records are written sorted by family, table, prefix and
+ *		metric, which lets a diff walk both files once side by side.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/rtnetlink.h>
+#include "config.h"
+#include "net-support.h"
+#include "intl.h"
+#include "util.h"
+#include "fib.h"
+
+#ifndef RTF_CACHE
+#define RTF_CACHE	0x01000000
+#endif
+
+#define SNAP_MAGIC	"NTFIB\0\0\0"
+#define SNAP_VERSION	2
+
+struct snap_head {
+    char magic[8];
+    __u32 version;
+    __u32 count;
+    __u32 time;
+    __u32 flags;
+    char host[64];
+};
+
+/* Family, table, destination, TOS and metric are the key of a route, as
+   for the kernel; type and protocol can change like the next hop. */
+struct snap_rec {
+    __u8 family;
+    __u8 dst_len;
+    __u8 type;
+    __u8 protocol;
+    __u8 tos;
+    __u8 pad[3];
+    __u32 table;
+    __u8 dst[16];
+    __u32 metric;
+    __u8 gw[16];
+    char iface[IFNAMSIZ];
+    __u32 flags;
+};
+
+struct snap {
+    const char *name;
+    struct snap_head head;
+    struct snap_rec *rec;
+    unsigned long count, size;
+};
+
+static int snap_key_cmp(const struct snap_rec *x, const struct snap_rec *y)
+{
+    int d;
+
+    if (x->family != y->family)
+	return x->family - y->family;
+    if (x->table != y->table)
+	return ntohl(x->table) < ntohl(y->table) ? -1 : 1;
+    if ((d = memcmp(x->dst, y->dst, sizeof(x->dst))))
+	return d;
+    if (x->dst_len != y->dst_len)
+	return x->dst_len - y->dst_len;
+    if (x->tos != y->tos)
+	return x->tos - y->tos;
+    if (x->metric != y->metric)
+	return ntohl(x->metric) < ntohl(y->metric) ? -1 : 1;
+    return 0;
+}
+
+/* By key, then the next hops of a multipath route by gateway and
+   interface. */
+static int snap_cmp(const void *a, const void *b)
+{
+    const struct snap_rec *x = a, *y = b;
+    int d;
+
+    if ((d = snap_key_cmp(x, y)))
+	return d;
+    if ((d = memcmp(x->gw, y->gw, sizeof(x->gw))))
+	return d;
+    return strncmp(x->iface, y->iface, sizeof(x->iface));
+}
+
+static struct snap_rec *snap_new(struct snap *s)
+{
+    struct snap_rec *r;
+
+    if (s->count == s->size) {
+	s->size = s->size ? s->size * 2 : 4096;
+	s->rec = xrealloc(s->rec, s->size * sizeof(*s->rec));
+    }
+    r = &s->rec[s->count++];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+#if HAVE_AFINET
+static int snap_add4(struct fib4_entry *e, void *arg)
+{
+    struct snap_rec *r = snap_new(arg);
+
+    r->family = AF_INET;
+    r->dst_len = e->dst_len;
+    r->type = e->type;
+    r->protocol = e->protocol;
+    r->tos = e->tos;
+    r->table = htonl(e->table);
+    memcpy(r->dst, &e->dst, 4);
+    r->metric = htonl(e->metric);
+    memcpy(r->gw, &e->gw, 4);
+    safe_strncpy(r->iface, e->iface, sizeof(r->iface));
+    r->flags = htonl(e->flags);
+    return 0;
+}
+#endif
+
+#if HAVE_AFINET6
+static int snap_add6(struct fib6_entry *e, void *arg)
+{
+    struct snap_rec *r;
+
+    if (e->flags & RTF_CACHE)
+	return 0;
+    r = snap_new(arg);
+    r->family = AF_INET6;
+    r->dst_len = e->dst_len;
+    r->type = e->type;
+    r->protocol = e->protocol;
+    r->table = htonl(e->table);
+    memcpy(r->dst, &e->dst, 16);
+    r->metric = htonl(e->metric);
+    memcpy(r->gw, &e->gw, 16);
+    safe_strncpy(r->iface, e->iface, sizeof(r->iface));
+    r->flags = htonl(e->flags);
+    return 0;
+}
+#endif
+
+/* Read the live tables of the families in afname.  Snapshots are for
+   comparing routers, so they default to the main tables, where the
+   local addresses of a host do not get in the way. */
+static int snap_read(struct snap *s, const char *afname, int options)
+{
+    char buf[256], *tmp1, *tmp2;
+    int table = route_table == FIB_TABLE_PROC ? RT_TABLE_MAIN : route_table;
+    unsigned long before;
+
+    memset(s, 0, sizeof(*s));
+    s->name = _("(kernel)");
+    memcpy(s->head.magic, SNAP_MAGIC, sizeof(s->head.magic));
+    s->head.time = time(NULL);
+    gethostname(s->head.host, sizeof(s->head.host) - 1);
+
+    safe_strncpy(buf, afname, sizeof(buf));
+    for (tmp1 = buf; tmp1; tmp1 = tmp2) {
+	if ((tmp2 = strchr(tmp1, ',')))
+	    *tmp2++ = '\0';
+	if (!tmp1[0])
+	    continue;
+	before = s->count;
+#if HAVE_AFINET
+	if (!strcmp(tmp1, "inet")) {
+	    if ((options & FLAG_PROC) || fib4_read_netlink(table, snap_add4, s) < 0) {
+		if (s->count != before || route_table != FIB_TABLE_PROC ||
+		    fib4_read_proc(snap_add4, s) < 0) {
+		    perror(_("route: cannot read the IPv4 routing table"));
+		    return -1;
+		}
+	    }
+	    continue;
+	}
+#endif
+#if HAVE_AFINET6
+	if (!strcmp(tmp1, "inet6")) {
+	    if ((options & FLAG_PROC) || fib6_read_netlink(table, snap_add6, s) < 0) {
+		if (s->count != before || route_table != FIB_TABLE_PROC ||
+		    fib6_read_proc(snap_add6, s) < 0) {
+		    perror(_("route: cannot read the IPv6 routing table"));
+		    return -1;
+		}
+	    }
+	    continue;
+	}
+#endif
+	fprintf(stderr, _("No route snapshots for address family `%s'.\n"), tmp1);
+	return -1;
+    }
+    qsort(s->rec, s->count, sizeof(*s->rec), snap_cmp);
+    s->head.count = s->count;
+    return 0;
+}
+
+int route_save(const char *file, const char *afname, int options)
+{
+    struct snap s;
+    struct snap_head h;
+    FILE *fp = stdout;
+    int rc = 0;
+
+    if (snap_read(&s, afname, options) < 0) {
+	free(s.rec);
+	return E_SOCK;
+    }
+    if (strcmp(file, "-") && (fp = fopen(file, "w")) == NULL) {
+	perror(file);
+	free(s.rec);
+	return E_INTERN;
+    }
+    h = s.head;
+    h.version = htonl(SNAP_VERSION);
+    h.count = htonl(s.count);
+    h.time = htonl(s.head.time);
+    if (fwrite(&h, sizeof(h), 1, fp) != 1 ||
+	fwrite(s.rec, sizeof(*s.rec), s.count, fp) != s.count ||
+	fflush(fp) == EOF) {
+	perror(file);
+	rc = E_INTERN;
+    }
+    if (fp != stdout && fclose(fp) == EOF && !rc) {
+	perror(file);
+	rc = E_INTERN;
+    }
+    if (!rc && (options & FLAG_VERBOSE))
+	fprintf(stderr, _("route: %lu routes saved to %s\n"), s.count, file);
+    free(s.rec);
+    return rc;
+}
+
+static int snap_load(struct snap *s, const char *file)
+{
+    FILE *fp;
+    unsigned long i;
+    int sorted = 1;
+
+    memset(s, 0, sizeof(*s));
+    s->name = file;
+    if ((fp = fopen(file, "r")) == NULL) {
+	perror(file);
+	return -1;
+    }
+    if (fread(&s->head, sizeof(s->head), 1, fp) != 1 ||
+	memcmp(s->head.magic, SNAP_MAGIC, sizeof(s->head.magic)) ||
+	ntohl(s->head.version) != SNAP_VERSION) {
+	fprintf(stderr, _("route: %s: not a route snapshot\n"), file);
+	fclose(fp);
+	return -1;
+    }
+    s->head.host[sizeof(s->head.host) - 1] = '\0';
+    s->head.time = ntohl(s->head.time);
+    s->count = s->size = ntohl(s->head.count);
+    s->rec = xmalloc((s->size ? s->size : 1) * sizeof(*s->rec));
+    if (fread(s->rec, sizeof(*s->rec), s->count, fp) != s->count) {
+	fprintf(stderr, _("route: %s: truncated snapshot\n"), file);
+	fclose(fp);
+	return -1;
+    }
+    fclose(fp);
+    for (i = 0; i < s->count; i++) {
+	s->rec[i].iface[IFNAMSIZ - 1] = '\0';
+	if (i && sorted && snap_cmp(&s->rec[i - 1], &s->rec[i]) > 0)
+	    sorted = 0;
+    }
+    if (!sorted)
+	qsort(s->rec, s->count, sizeof(*s->rec), snap_cmp);
+    return 0;
+}
+
+/* One line per route, numeric and never truncated, so that the output
+   of two diffs can be compared again with text tools. */
+static void snap_print(char tag, const struct snap_rec *r)
+{
+    char dst[INET6_ADDRSTRLEN], gw[INET6_ADDRSTRLEN];
+    static const __u8 zero[16];
+    int alen = r->family == AF_INET ? 4 : 16;
+
+    inet_ntop(r->family, r->dst, dst, sizeof(dst));
+    printf("%c %s/%u", tag, dst, r->dst_len);
+    if (r->tos)
+	printf(" tos 0x%x", r->tos);
+    if (memcmp(r->gw, zero, alen)) {
+	inet_ntop(r->family, r->gw, gw, sizeof(gw));
+	printf(" via %s", gw);
+    }
+    if (r->iface[0] && strcmp(r->iface, "*"))
+	printf(" dev %s", r->iface);
+    printf(" metric %u table %s", ntohl(r->metric), route_table_name(ntohl(r->table)));
+    if (r->protocol)
+	printf(" proto %u", r->protocol);
+    if (r->type != RTN_UNICAST)
+	printf(" type %u", r->type);
+    printf(" flags 0x%x\n", ntohl(r->flags));
+}
+
+static void snap_title(char tag, const struct snap *s)
+{
+    char when[64];
+    time_t t = s->head.time;
+
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    printf("%c%c%c %s %s %s, %lu routes\n", tag, tag, tag, s->name,
+	   s->head.host, when, s->count);
+}
+
+struct snap_diff {
+    unsigned long added, removed, changed;
+};
+
+/* Both groups share one key; pair their next hops up by gateway and
+   interface, which is the order they are sorted in. */
+static void snap_group(struct snap_diff *d, const struct snap_rec *a, int na,
+		       const struct snap_rec *b, int nb)
+{
+    int i = 0, j = 0, c;
+
+    if (na == 1 && nb == 1) {
+	if (memcmp(a, b, sizeof(*a))) {
+	    snap_print('<', a);
+	    snap_print('>', b);
+	    d->changed++;
+	}
+	return;
+    }
+    while (i < na || j < nb) {
+	if (i == na)
+	    c = 1;
+	else if (j == nb)
+	    c = -1;
+	else
+	    c = snap_cmp(&a[i], &b[j]);
+	if (c < 0) {
+	    snap_print('-', &a[i++]);
+	    d->removed++;
+	} else if (c > 0) {
+	    snap_print('+', &b[j++]);
+	    d->added++;
+	} else {
+	    if (memcmp(&a[i], &b[j], sizeof(*a))) {
+		snap_print('<', &a[i]);
+		snap_print('>', &b[j]);
+		d->changed++;
+	    }
+	    i++;
+	    j++;
+	}
+    }
+}
+
+/* Compare snapshot a with snapshot b, or with the live tables when b is
+   NULL.  Exits like diff(1): 0 when equal, 1 when not, 2 on trouble. */
+int route_diff(const char *a, const char *b, const char *afname, int options)
+{
+    struct snap sa, sb;
+    struct snap_diff d;
+    struct timeval start;
+    unsigned long i = 0, j = 0, ie, je;
+    int c, rc = E_INTERN;
+
+    memset(&sb, 0, sizeof(sb));
+    if (snap_load(&sa, a) < 0)
+	goto out;
+    if (b ? snap_load(&sb, b) < 0 : snap_read(&sb, afname, options) < 0)
+	goto out;
+
+    gettimeofday(&start, NULL);
+    memset(&d, 0, sizeof(d));
+    snap_title('-', &sa);
+    snap_title('+', &sb);
+    while (i < sa.count || j < sb.count) {
+	if (i == sa.count)
+	    c = 1;
+	else if (j == sb.count)
+	    c = -1;
+	else
+	    c = snap_key_cmp(&sa.rec[i], &sb.rec[j]);
+	if (c < 0) {
+	    snap_print('-', &sa.rec[i++]);
+	    d.removed++;
+	    continue;
+	}
+	if (c > 0) {
+	    snap_print('+', &sb.rec[j++]);
+	    d.added++;
+	    continue;
+	}
+	for (ie = i + 1; ie < sa.count && !snap_key_cmp(&sa.rec[ie], &sa.rec[i]); ie++)
+	    ;
+	for (je = j + 1; je < sb.count && !snap_key_cmp(&sb.rec[je], &sb.rec[j]); je++)
+	    ;
+	snap_group(&d, &sa.rec[i], ie - i, &sb.rec[j], je - j);
+	i = ie;
+	j = je;
+    }
+    printf(_("%lu added, %lu removed, %lu changed\n"), d.added, d.removed, d.changed);
+    if (options & FLAG_VERBOSE)
+	fprintf(stderr, _("route: compared %lu and %lu routes in %.3fs\n"),
+		sa.count, sb.count, elapsed(&start));
+    rc = (d.added || d.removed || d.changed) ? 1 : 0;
+  out:
+    free(sa.rec);
+    free(sb.rec);
+    return rc;
+}
@@ -0,0 +1,331 @@
+/*
+ * lib/statneigh.c	Neighbour table pressure for "arp --pressure":
+ *			entries per state and device against the garbage
+ *			collection thresholds, and the overflow counters.
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		Once more entries than gc_thresh3 are subject to garbage
+ *		collection, the kernel refuses new neighbours ("neighbour
+ *		table overflow") and packets to them are dropped.  Newer
+ *		kernels leave permanent and externally learned entries out
+ *		of that count, so they are counted separately here.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <linux/neighbour.h>
+#include "config.h"
+#include "net-support.h"
+#include "intl.h"
+#include "util.h"
+#include "neigh.h"
+
+#ifndef NTF_EXT_LEARNED
+#define NTF_EXT_LEARNED	0x10
+#endif
+
+#define NP_STATES	9		/* NUD_* bits and NONE */
+
+struct np_dev {
+    int ifindex;
+    unsigned long n[2];
+    char name[IFNAMSIZ];
+};
+
+/* Counters of one family from /proc/net/stat, summed over the CPUs. */
+struct np_stat {
+    unsigned long forced_gc, table_fulls, discards, res_failed;
+};
+
+struct np_family {
+    const char *name;			/* IPv4, IPv6 */
+    const char *sysctl;			/* ipv4, ipv6 */
+    const char *stat;			/* /proc/net/stat file */
+    int af;
+    int thresh[3];
+    unsigned long total, gc, state[NP_STATES];
+    struct np_stat st;
+};
+
+struct np_ctx {
+    struct np_family fam[2];
+    struct np_dev *dev;			/* open addressing on ifindex */
+    int ndev, size;
+};
+
+static struct np_dev *np_dev(struct np_ctx *c, int ifindex)
+{
+    int i, mask = c->size - 1;
+
+    if (c->ndev * 2 >= c->size) {
+	struct np_dev *old = c->dev;
+	int osize = c->size;
+
+	c->size = c->size ? c->size * 2 : 256;
+	c->dev = xmalloc(c->size * sizeof(*c->dev));
+	memset(c->dev, 0, c->size * sizeof(*c->dev));
+	mask = c->size - 1;
+	for (i = 0; i < osize; i++) {
+	    int j = old[i].ifindex & mask;
+
+	    if (!old[i].ifindex)
+		continue;
+	    while (c->dev[j].ifindex)
+		j = (j + 1) & mask;
+	    c->dev[j] = old[i];
+	}
+	free(old);
+    }
+    for (i = ifindex & mask; c->dev[i].ifindex; i = (i + 1) & mask)
+	if (c->dev[i].ifindex == ifindex)
+	    return &c->dev[i];
+    c->dev[i].ifindex = ifindex;
+    c->ndev++;
+    return &c->dev[i];
+}
+
+static int np_state(unsigned int state)
+{
+    int i;
+
+    for (i = 0; i < NP_STATES - 1; i++)
+	if (state & (1 << i))
+	    return i;
+    return NP_STATES - 1;
+}
+
+static int np_add(struct neigh_entry *e, void *arg)
+{
+    struct np_ctx *c = arg;
+    int f = e->family == AF_INET6;
+    struct np_dev *d;
+
+    /* proxy entries live outside the table */
+    if (e->ntf & NTF_PROXY)
+	return 0;
+    c->fam[f].total++;
+    c->fam[f].state[np_state(e->state)]++;
+    if (!(e->state & NUD_PERMANENT) && !(e->ntf & NTF_EXT_LEARNED))
+	c->fam[f].gc++;
+    d = np_dev(c, e->ifindex > 0 ? e->ifindex : -1);
+    if (!d->name[0])
+	safe_strncpy(d->name, e->iface, sizeof(d->name));
+    d->n[f]++;
+    return 0;
+}
+
+static int np_thresh(const char *sysctl, int i)
+{
+    char path[128];
+    FILE *fp;
+    int val = -1;
+
+    snprintf(path, sizeof(path), "/proc/sys/net/%s/neigh/default/gc_thresh%d", sysctl, i);
+    if ((fp = fopen(path, "r")) == NULL)
+	return -1;
+    if (fscanf(fp, "%d", &val) != 1)
+	val = -1;
+    fclose(fp);
+    return val;
+}
+
+/* /proc/net/stat/{arp,ndisc}_cache: a header naming the columns and a
+   row of hex counters per CPU. */
+static void np_read_stat(struct np_family *f)
+{
+    char line[1024], *names[32], *tok, *p;
+    unsigned long val;
+    int ncol = 0, i;
+    FILE *fp;
+
+    memset(&f->st, 0, sizeof(f->st));
+    if ((fp = fopen(f->stat, "r")) == NULL)
+	return;
+    if (!fgets(line, sizeof(line), fp)) {
+	fclose(fp);
+	return;
+    }
+    for (tok = strtok(line, " \t\n"); tok && ncol < 32; tok = strtok(NULL, " \t\n"))
+	names[ncol++] = xstrdup(tok);
+    while (fgets(line, sizeof(line), fp)) {
+	for (i = 0, p = line; i < ncol; i++) {
+	    val = strtoul(p, &tok, 16);
+	    if (tok == p)
+		break;
+	    p = tok;
+	    if (!strcmp(names[i], "forced_gc_runs"))
+		f->st.forced_gc += val;
+	    else if (!strcmp(names[i], "table_fulls"))
+		f->st.table_fulls += val;
+	    else if (!strcmp(names[i], "unresolved_discards"))
+		f->st.discards += val;
+	    else if (!strcmp(names[i], "res_failed"))
+		f->st.res_failed += val;
+	}
+    }
+    for (i = 0; i < ncol; i++)
+	free(names[i]);
+    fclose(fp);
+}
+
+static int np_read(struct np_ctx *c, int family)
+{
+    int f, i;
+
+    for (f = 0; f < 2; f++) {
+	c->fam[f].total = c->fam[f].gc = 0;
+	memset(c->fam[f].state, 0, sizeof(c->fam[f].state));
+	for (i = 0; i < 3; i++)
+	    c->fam[f].thresh[i] = np_thresh(c->fam[f].sysctl, i + 1);
+	np_read_stat(&c->fam[f]);
+    }
+    for (i = 0; i < c->size; i++)
+	c->dev[i].n[0] = c->dev[i].n[1] = 0;
+    if (neigh_read_netlink(family, np_add, c) < 0) {
+	perror("RTM_GETNEIGH");
+	return -1;
+    }
+    return 0;
+}
+
+static int np_percent(unsigned long n, int thresh)
+{
+    return thresh > 0 ? (int) (n * 100 / thresh) : 0;
+}
+
+static void np_warn(const struct np_family *f)
+{
+    if (f->thresh[2] > 0 && f->gc >= (unsigned long) f->thresh[2])
+	printf(_("WARNING: %s table is full, new neighbours are refused\n"), f->name);
+    else if (f->thresh[1] > 0 && f->gc >= (unsigned long) f->thresh[1])
+	printf(_("WARNING: %s table is above gc_thresh2, forced garbage collection is running\n"),
+	       f->name);
+}
+
+static int np_devcmp(const void *a, const void *b)
+{
+    const struct np_dev *x = a, *y = b;
+    unsigned long nx = x->n[0] + x->n[1], ny = y->n[0] + y->n[1];
+
+    if (nx != ny)
+	return nx < ny ? 1 : -1;
+    return strcmp(x->name, y->name);
+}
+
+static void np_report(struct np_ctx *c, int family)
+{
+    static const char *states[NP_STATES] = {
+	"INCOMPLETE", "REACHABLE", "STALE", "DELAY",
+	"PROBE", "FAILED", "NOARP", "PERMANENT", "NONE"
+    };
+    struct np_dev *dev;
+    int f, i, n;
+
+    for (f = 0; f < 2; f++) {
+	struct np_family *fa = &c->fam[f];
+
+	if (family != AF_UNSPEC && family != fa->af)
+	    continue;
+	printf(_("%s neighbour table: %lu entries, %lu subject to garbage collection\n"),
+	       fa->name, fa->total, fa->gc);
+	printf(_("  gc_thresh1 %d  gc_thresh2 %d  gc_thresh3 %d  (%d%% of gc_thresh3)\n"),
+	       fa->thresh[0], fa->thresh[1], fa->thresh[2], np_percent(fa->gc, fa->thresh[2]));
+	printf(_("  table full %lu times, forced gc runs %lu, unresolved discards %lu, "
+		 "resolution failures %lu\n"),
+	       fa->st.table_fulls, fa->st.forced_gc, fa->st.discards, fa->st.res_failed);
+	np_warn(fa);
+	printf(_("  State        Entries\n"));
+	for (i = 0; i < NP_STATES; i++)
+	    if (fa->state[i])
+		printf("  %-12s %7lu\n", states[i], fa->state[i]);
+	printf("\n");
+    }
+
+    /* busiest devices first */
+    dev = xmalloc((c->ndev + 1) * sizeof(*dev));
+    for (i = n = 0; i < c->size; i++)
+	if (c->dev[i].ifindex && c->dev[i].n[0] + c->dev[i].n[1])
+	    dev[n++] = c->dev[i];
+    qsort(dev, n, sizeof(*dev), np_devcmp);
+    printf(_("Iface             IPv4    IPv6\n"));
+    for (i = 0; i < n; i++)
+	printf("%-15s %7lu %7lu\n", dev[i].name, dev[i].n[0], dev[i].n[1]);
+    free(dev);
+}
+
+/*
+ * arp --pressure [secs]: one report, or the report followed by a line
+ * per family every secs seconds with the rate at which the table and
+ * the overflow counters grow.
+ */
+int neigh_pressure(int family, int interval)
+{
+    struct np_ctx c;
+    struct np_family last[2];
+    struct timeval then, now;
+    double secs;
+    char stamp[32];
+    time_t t;
+    int f;
+
+    memset(&c, 0, sizeof(c));
+    c.fam[0].name = "IPv4";
+    c.fam[0].sysctl = "ipv4";
+    c.fam[0].stat = "/proc/net/stat/arp_cache";
+    c.fam[0].af = AF_INET;
+    c.fam[1].name = "IPv6";
+    c.fam[1].sysctl = "ipv6";
+    c.fam[1].stat = "/proc/net/stat/ndisc_cache";
+    c.fam[1].af = AF_INET6;
+
+    if (np_read(&c, family) < 0)
+	return -1;
+    np_report(&c, family);
+    if (interval <= 0) {
+	free(c.dev);
+	return 0;
+    }
+
+    printf(_("\nTime       Family  Entries   Rate/s  gc/thresh3     Used  Full/new  Forced/new\n"));
+    gettimeofday(&then, NULL);
+    for (;;) {
+	fflush(stdout);
+	memcpy(last, c.fam, sizeof(last));
+	sleep(interval);
+	if (np_read(&c, family) < 0)
+	    break;
+	gettimeofday(&now, NULL);
+	secs = (now.tv_sec - then.tv_sec) + (now.tv_usec - then.tv_usec) / 1e6;
+	then = now;
+	t = now.tv_sec;
+	strftime(stamp, sizeof(stamp), "%H:%M:%S", localtime(&t));
+	for (f = 0; f < 2; f++) {
+	    struct np_family *fa = &c.fam[f];
+
+	    if (family != AF_UNSPEC && family != fa->af)
+		continue;
+	    printf("%-10s %-6s %8lu %+8.1f  %6lu/%-6d %3d%% %6lu%+4ld %6lu%+4ld\n",
+		   stamp, fa->name, fa->total,
+		   secs > 0 ? ((double) fa->total - last[f].total) / secs : 0.0,
+		   fa->gc, fa->thresh[2], np_percent(fa->gc, fa->thresh[2]),
+		   fa->st.table_fulls, (long) (fa->st.table_fulls - last[f].st.table_fulls),
+		   fa->st.forced_gc, (long) (fa->st.forced_gc - last[f].st.forced_gc));
+	    np_warn(fa);
+	}
+    }
+    free(c.dev);
+    return -1;
+}
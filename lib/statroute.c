@@ -0,0 +1,415 @@
+/*
+ * lib/statroute.c	Routing table statistics for "route --stats".
+ *
+ * NET-LIB	A collection of functions used from the base set of the
+ *		NET-3 Networking Distribution for the LINUX operating
+ *		system. (net-tools, net-drivers)
+ *
+ *		The table is read once through the FIB readers and folded
+ *		into counters as it streams by: per prefix length, next hop,
+ *		interface, protocol and route type.  Next hops and interfaces
+ *		are interned, so each route only leaves a few bytes behind in
+ *		a prefix trie, and a walk of that trie afterwards finds the
+ *		routes that are more specifics of another one.
+ *
+ *		This program is free software; you can redistribute it
+ *		and/or  modify it under  the terms of  the GNU General
+ *		Public  License as  published  by  the  Free  Software
+ *		Foundation;  either  version 2 of the License, or  (at
+ *		your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <net/route.h>
+#include <linux/rtnetlink.h>
+#include "config.h"
+#include "net-support.h"
+#include "intl.h"
+#include "util.h"
+#include "fib.h"
+
+#ifndef RTF_CACHE
+#define RTF_CACHE	0x01000000
+#endif
+
+/* Interned 16 byte keys (an address or an interface name) with a route
+   count each, in an open addressing hash. */
+struct stat_cnt {
+    unsigned char key[16];
+    unsigned long routes;
+    unsigned int id;
+    int used;
+};
+
+struct stat_tab {
+    struct stat_cnt *v;
+    unsigned int size, used;
+};
+
+/* What the trie keeps per prefix. */
+struct stat_route {
+    unsigned int gw, dev;	/* ids in the gateway and interface tables */
+    unsigned char plen;
+};
+
+#define STAT_CHUNK	65536
+
+struct stat_chunk {
+    struct stat_chunk *next;
+    struct stat_route r[STAT_CHUNK];
+};
+
+struct stat_ctx {
+    int family, bits;
+    unsigned long routes, prefixes, dups, skipped;
+    unsigned long plen[129];
+    unsigned long proto[256];
+    unsigned long type[RTN_MAX + 1];
+    struct stat_tab gw, dev;
+    struct fib_trie t;
+    struct stat_chunk *chunk;
+    unsigned int nchunk;
+    /* filled by the trie walk */
+    unsigned long covered, same_hop;
+};
+
+static unsigned int tab_slot(struct stat_tab *t, const unsigned char *key)
+{
+    unsigned int i = fnv_hash(FNV_INIT, key, 16) & (t->size - 1);
+
+    while (t->v[i].used && memcmp(t->v[i].key, key, 16))
+	i = (i + 1) & (t->size - 1);
+    return i;
+}
+
+static void tab_grow(struct stat_tab *t)
+{
+    struct stat_cnt *old = t->v;
+    unsigned int i, osize = t->size;
+
+    t->size = osize ? osize * 2 : 64;
+    t->v = xmalloc(t->size * sizeof(*t->v));
+    memset(t->v, 0, t->size * sizeof(*t->v));
+    for (i = 0; i < osize; i++)
+	if (old[i].used)
+	    t->v[tab_slot(t, old[i].key)] = old[i];
+    free(old);
+}
+
+/* Count one route for key and return its id, which unlike the slot
+   stays the same when the table grows. */
+static unsigned int tab_count(struct stat_tab *t, const void *key)
+{
+    unsigned int i;
+
+    if (2 * (t->used + 1) > t->size)
+	tab_grow(t);
+    i = tab_slot(t, key);
+    if (!t->v[i].used) {
+	memcpy(t->v[i].key, key, 16);
+	t->v[i].id = t->used++;
+	t->v[i].used = 1;
+    }
+    t->v[i].routes++;
+    return t->v[i].id;
+}
+
+static int cnt_cmp(const void *a, const void *b)
+{
+    const struct stat_cnt *x = a, *y = b;
+
+    if (x->used != y->used)
+	return y->used - x->used;
+    if (x->routes != y->routes)
+	return x->routes < y->routes ? 1 : -1;
+    return memcmp(x->key, y->key, 16);
+}
+
+static struct stat_route *stat_new(struct stat_ctx *c)
+{
+    struct stat_chunk *ch;
+
+    if (!c->chunk || c->nchunk == STAT_CHUNK) {
+	ch = xmalloc(sizeof(*ch));
+	ch->next = c->chunk;
+	c->chunk = ch;
+	c->nchunk = 0;
+    }
+    return &c->chunk->r[c->nchunk++];
+}
+
+/* One route: count it everywhere, and remember its prefix. */
+static void stat_add(struct stat_ctx *c, const void *dst, int plen,
+		     const void *gw, const char *iface, int protocol, int type)
+{
+    unsigned char key[16];
+    unsigned int gwi, devi;
+    __u32 k[4];
+    void **slot;
+
+    c->routes++;
+    c->plen[plen]++;
+    c->proto[protocol & 255]++;
+    if (type <= RTN_MAX)
+	c->type[type]++;
+
+    memset(key, 0, sizeof(key));
+    memcpy(key, gw, c->bits / 8);
+    gwi = tab_count(&c->gw, key);
+    memset(key, 0, sizeof(key));
+    memcpy(key, iface, strnlen(iface, sizeof(key)));
+    devi = tab_count(&c->dev, key);
+
+    if (c->family == AF_INET)
+	fib_key4(k, *(const struct in_addr *) dst);
+    else
+	fib_key6(k, dst);
+    slot = fib_trie_insert(&c->t, k, plen);
+    if (*slot) {
+	c->dups++;
+	return;
+    }
+    c->prefixes++;
+    *slot = stat_new(c);
+    ((struct stat_route *) *slot)->gw = gwi;
+    ((struct stat_route *) *slot)->dev = devi;
+    ((struct stat_route *) *slot)->plen = plen;
+}
+
+#if HAVE_AFINET
+static int stat_add4(struct fib4_entry *e, void *arg)
+{
+    stat_add(arg, &e->dst, e->dst_len, &e->gw, e->iface, e->protocol, e->type);
+    return 0;
+}
+#endif
+
+#if HAVE_AFINET6
+static int stat_add6(struct fib6_entry *e, void *arg)
+{
+    if (e->flags & RTF_CACHE) {
+	((struct stat_ctx *) arg)->skipped++;
+	return 0;
+    }
+    stat_add(arg, &e->dst, e->dst_len, &e->gw, e->iface, e->protocol, e->type);
+    return 0;
+}
+#endif
+
+/* A route is a more specific when a shorter prefix other than the
+   default route covers it; with the same next hop it changes nothing. */
+static void stat_cover(void *data, void *cover, void *arg)
+{
+    struct stat_ctx *c = arg;
+    struct stat_route *r = data, *p = cover;
+
+    if (!p || !p->plen)
+	return;
+    c->covered++;
+    if (r->gw == p->gw && r->dev == p->dev)
+	c->same_hop++;
+}
+
+static const struct {
+    int proto;
+    const char *name;
+} stat_protos[] = {
+    { 0, "unspec" }, { 1, "redirect" }, { 2, "kernel" }, { 3, "boot" },
+    { 4, "static" }, { 8, "gated" }, { 9, "ra" }, { 10, "mrt" },
+    { 11, "zebra" }, { 12, "bird" }, { 13, "dnrouted" }, { 14, "xorp" },
+    { 15, "ntk" }, { 16, "dhcp" }, { 17, "mrouted" }, { 18, "keepalived" },
+    { 42, "babel" }, { 99, "openr" }, { 186, "bgp" }, { 187, "isis" },
+    { 188, "ospf" }, { 189, "rip" }, { 192, "eigrp" },
+};
+
+static const char *stat_types[] = {
+    "unspec", "unicast", "local", "broadcast", "anycast", "multicast",
+    "blackhole", "unreachable", "prohibit", "throw", "nat", "xresolve",
+};
+
+static void stat_pct(unsigned long n, unsigned long total)
+{
+    printf(" %6.2f%%\n", total ? 100.0 * n / total : 0.0);
+}
+
+static void stat_list(struct stat_tab *t, const char *head, int family,
+		      unsigned long total)
+{
+    char buf[INET6_ADDRSTRLEN];
+    unsigned int i;
+
+    /* the slots are done with, the counts can be sorted in place */
+    qsort(t->v, t->size, sizeof(*t->v), cnt_cmp);
+    printf("\n%-39s %10s\n", head, _("Routes"));
+    for (i = 0; i < t->used; i++) {
+	if (family) {
+	    inet_ntop(family, t->v[i].key, buf, sizeof(buf));
+	    printf("%-39s %10lu", strcmp(buf, "0.0.0.0") && strcmp(buf, "::") ?
+		   buf : "*", t->v[i].routes);
+	} else
+	    printf("%-39.16s %10lu", (char *) t->v[i].key, t->v[i].routes);
+	stat_pct(t->v[i].routes, total);
+    }
+}
+
+static void stat_print(struct stat_ctx *c, double secs)
+{
+    unsigned int i, j;
+
+    printf(_("Routes           %10lu\n"), c->routes);
+    printf(_("Prefixes         %10lu"), c->prefixes);
+    if (c->dups)
+	printf(_("  (%lu routes share a prefix with another)"), c->dups);
+    printf("\n");
+    printf(_("More specifics   %10lu"), c->covered);
+    stat_pct(c->covered, c->prefixes);
+    printf(_("  same next hop  %10lu"), c->same_hop);
+    stat_pct(c->same_hop, c->prefixes);
+
+    printf("\n%-39s %10s\n", _("Prefix length"), _("Routes"));
+    for (i = 0; i <= c->bits; i++)
+	if (c->plen[i]) {
+	    printf("/%-38u %10lu", i, c->plen[i]);
+	    stat_pct(c->plen[i], c->routes);
+	}
+
+    stat_list(&c->gw, _("Gateway"), c->family, c->routes);
+    stat_list(&c->dev, _("Interface"), 0, c->routes);
+
+    printf("\n%-39s %10s\n", _("Protocol"), _("Routes"));
+    for (i = 0; i < 256; i++) {
+	const char *name = NULL;
+	char buf[16];
+
+	if (!c->proto[i])
+	    continue;
+	for (j = 0; j < sizeof(stat_protos) / sizeof(stat_protos[0]); j++)
+	    if (stat_protos[j].proto == i)
+		name = stat_protos[j].name;
+	if (!name) {
+	    snprintf(buf, sizeof(buf), "%u", i);
+	    name = buf;
+	}
+	printf("%-39s %10lu", name, c->proto[i]);
+	stat_pct(c->proto[i], c->routes);
+    }
+
+    printf("\n%-39s %10s\n", _("Type"), _("Routes"));
+    for (i = 0; i <= RTN_MAX; i++)
+	if (c->type[i]) {
+	    if (i < sizeof(stat_types) / sizeof(stat_types[0]))
+		printf("%-39s %10lu", stat_types[i], c->type[i]);
+	    else
+		printf("%-39u %10lu", i, c->type[i]);
+	    stat_pct(c->type[i], c->routes);
+	}
+    if (secs >= 0)
+	printf(_("\n%lu trie nodes, %.3fs\n"), c->t.nodes, secs);
+}
+
+static void stat_free(struct stat_ctx *c)
+{
+    struct stat_chunk *ch;
+
+    fib_trie_free(&c->t, NULL);
+    while ((ch = c->chunk) != NULL) {
+	c->chunk = ch->next;
+	free(ch);
+    }
+    free(c->gw.v);
+    free(c->dev.v);
+}
+
+static int stat_family(int family, int options)
+{
+    struct stat_ctx *c;
+    struct timeval start;
+    int table = route_table, rc = 0, proc = options & FLAG_PROC;
+
+    c = xmalloc(sizeof(*c));
+    memset(c, 0, sizeof(*c));
+    c->family = family;
+    c->bits = family == AF_INET ? 32 : 128;
+    fib_trie_init(&c->t, c->bits);
+    gettimeofday(&start, NULL);
+
+#if HAVE_AFINET
+    if (family == AF_INET) {
+	if (table == FIB_TABLE_PROC)
+	    table = RT_TABLE_MAIN;
+	if (table == RT_TABLE_MAIN)
+	    printf(_("Kernel IP routing table statistics\n"));
+	else
+	    printf(_("Kernel IP routing table %s statistics\n"), route_table_name(table));
+	if (proc || fib4_read_netlink(table, stat_add4, c) < 0) {
+	    if (c->routes || route_table != FIB_TABLE_PROC ||
+		fib4_read_proc(stat_add4, c) < 0)
+		rc = -1;
+	}
+    }
+#endif
+#if HAVE_AFINET6
+    if (family == AF_INET6) {
+	if (table == FIB_TABLE_PROC)
+	    table = RT_TABLE_UNSPEC;
+	if (table == RT_TABLE_UNSPEC)
+	    printf(_("Kernel IPv6 routing table statistics\n"));
+	else
+	    printf(_("Kernel IPv6 routing table %s statistics\n"), route_table_name(table));
+	if (proc || fib6_read_netlink(table, stat_add6, c) < 0) {
+	    if (c->routes || route_table != FIB_TABLE_PROC ||
+		fib6_read_proc(stat_add6, c) < 0)
+		rc = -1;
+	}
+    }
+#endif
+    if (rc < 0) {
+	perror(family == AF_INET ? _("route: cannot read the IPv4 routing table") :
+	       _("route: cannot read the IPv6 routing table"));
+    } else {
+	fib_trie_walk(&c->t, stat_cover, c);
+	stat_print(c, (options & FLAG_VERBOSE) ? elapsed(&start) : -1);
+    }
+    stat_free(c);
+    free(c);
+    return rc;
+}
+
+/* route --stats: one report per address family in afname. */
+int route_stats(const char *afname, int options)
+{
+    char buf[256], *tmp1, *tmp2;
+    int rc = 0, first = 1;
+
+    safe_strncpy(buf, afname, sizeof(buf));
+    for (tmp1 = buf; tmp1; tmp1 = tmp2) {
+	if ((tmp2 = strchr(tmp1, ',')))
+	    *tmp2++ = '\0';
+	if (!tmp1[0])
+	    continue;
+	if (!first)
+	    printf("\n");
+	first = 0;
+#if HAVE_AFINET
+	if (!strcmp(tmp1, "inet")) {
+	    if (stat_family(AF_INET, options) < 0)
+		rc = E_SOCK;
+	    continue;
+	}
+#endif
+#if HAVE_AFINET6
+	if (!strcmp(tmp1, "inet6")) {
+	    if (stat_family(AF_INET6, options) < 0)
+		rc = E_SOCK;
+	    continue;
+	}
+#endif
+	fprintf(stderr, _("No route statistics for address family `%s'.\n"), tmp1);
+	return E_OPTERR;
+    }
+    return rc;
+}
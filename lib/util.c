@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
 #include <sys/utsname.h>
 
 #include "util.h"
@@ -58,3 +60,36 @@ char *safe_strncpy(char *dst, const char *src, size_t size)
     dst[size-1] = '\0';
     return strncpy(dst,src,size-1);
 }
+
+
+/* Wall clock time with microseconds, the prefix of monitor lines. */
+char *format_timestamp(char *buf, size_t size)
+{
+    struct timeval tv;
+    size_t n;
+
+    gettimeofday(&tv, NULL);
+    n = strftime(buf, size, "%Y-%m-%d %H:%M:%S", localtime(&tv.tv_sec));
+    snprintf(buf + n, size - n, ".%06ld", (long) tv.tv_usec);
+    return buf;
+}
+
+/* Seconds since start, for the timings of -v. */
+double elapsed(const struct timeval *start)
+{
+    struct timeval now;
+
+    gettimeofday(&now, NULL);
+    return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+/* FNV-1a over len bytes; start with FNV_INIT, or FNV_INIT mixed with a
+   small key that is not part of data. */
+unsigned int fnv_hash(unsigned int h, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    while (len--)
+	h = (h ^ *p++) * 16777619U;
+    return h;
+}
@@ -1,3 +1,6 @@
+#ifndef _NET_TOOLS_UTIL_H
+#define _NET_TOOLS_UTIL_H
+
 #include <stddef.h>
 
 void *xmalloc(size_t sz);
@@ -13,8 +16,30 @@ int kernel_version(void);
 
 int nstrcmp(const char *, const char *);
 
+/* precomputed nstrcmp() sort key */
+struct nstrkey {
+    int index;			/* length up to the trailing number */
+    int num;			/* trailing number                  */
+    int alias;			/* ":999" alias number or -1        */
+};
+
+void nstrkey_init(struct nstrkey *k, const char *name);
+int nstrkey_cmp(const char *a, const struct nstrkey *ak,
+		const char *b, const struct nstrkey *bk);
+
 char *safe_strncpy(char *dst, const char *src, size_t size);
 
+char *format_timestamp(char *buf, size_t size);
+
+struct timeval;
+double elapsed(const struct timeval *start);
+
+/* FNV-1a, for the hash tables of addresses and keys */
+#define FNV_INIT	2166136261U
+unsigned int fnv_hash(unsigned int h, const void *data, size_t len);
+
 
 #define netmin(a,b) ((a)<(b) ? (a) : (b))
 #define netmax(a,b) ((a)>(b) ? (a) : (b))
+
+#endif /* _NET_TOOLS_UTIL_H */
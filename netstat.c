@@ -88,6 +88,11 @@
 #include <sys/stat.h>
 #include <net/if.h>
 #include <dirent.h>
+#include <time.h>
+#include <stdarg.h>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <linux/pkt_sched.h>
 
 #include "net-support.h"
 #include "pathnames.h"
@@ -98,6 +103,9 @@
 #include "interface.h"
 #include "util.h"
 #include "proc.h"
+#include "libnetlink.h"
+#include "fib.h"
+#include "mcast.h"
 
 #include "../hidden.h"
 #if HAVE_SELINUX
@@ -119,6 +127,7 @@ int parsesnmp(int, int, int, int);
 void inittab(void);
 int parsesnmp6(int, int, int);
 void inittab6(void);
+int parsesoftnet(int);
 
 typedef enum {
     SS_FREE = 0,		/* not allocated                */
@@ -148,6 +157,11 @@ char *flag_int_name = NULL;
 int flag_rou = 0;
 int flag_mas = 0;
 int flag_sta = 0;
+int flag_softnet = 0;
+int flag_rate = 0;
+int flag_busy = 0;
+int flag_queues = 0;
+int flag_watch = 0;
 
 int flag_all = 0;
 int flag_lst = 0;
@@ -728,108 +742,72 @@ static void finish_this_one(int uid, unsigned long inode, const char *timers)
     putchar('\n');
 }
 
-static void igmp_do_one(int lnr, const char *line,const char *prot)
+/* Group names are looked up once: the same group (224.0.0.1, ff02::1) is
+   usually joined on every interface.  A small direct mapped cache is
+   enough for that. */
+#define IGMP_CACHE_SIZE 1024
+
+static struct igmp_name {
+    int family;
+    unsigned char group[16];
+    char name[128];
+} igmp_cache[IGMP_CACHE_SIZE];
+
+static const char *igmp_group(int family, const unsigned char *group)
 {
-    char mcast_addr[128];
-#if HAVE_AFINET6
-    struct sockaddr_in6 mcastaddr;
-    char addr6[INET6_ADDRSTRLEN];
-    struct in6_addr in6;
-    extern struct aftype inet6_aftype;
-#else
-    struct sockaddr_in mcastaddr;
-#endif
+    static char buf[INET6_ADDRSTRLEN];
+    int alen = family == AF_INET ? 4 : 16;
+    struct sockaddr_storage sas;
+    struct igmp_name *n;
     struct aftype *ap;
-    static int idx_flag = 0;
-    static int igmp6_flag = 0;
-    static char device[16];
-    int num, idx, refcnt;
-
-    if (lnr == 0) {
-	/* IPV6 ONLY */
-	/* igmp6 file does not have any comments on first line */
-	if ( strstr( line, "Device" ) == NULL ) {
-	    igmp6_flag = 1;
-	} else {
-	    /* IPV4 ONLY */
-	    /* 2.1.x kernels and up have Idx field */
-	    /* 2.0.x and below do not have Idx field */
-	    if ( strncmp( line, "Idx", strlen("Idx") ) == 0 )
-		idx_flag = 1;
-	    else
-		idx_flag = 0;
-	    return;
-	}
-    }
+    unsigned int h = family;
+    int i;
 
-    if (igmp6_flag) {    /* IPV6 */
-#if HAVE_AFINET6
-	num = sscanf( line, "%d %15s %64[0-9A-Fa-f] %d", &idx, device, mcast_addr, &refcnt );
-	if (num == 4) {
-	    /* Demangle what the kernel gives us */
-	    sscanf(mcast_addr, "%08X%08X%08X%08X",
-		   &in6.s6_addr32[0], &in6.s6_addr32[1],
-           &in6.s6_addr32[2], &in6.s6_addr32[3]);
-	    in6.s6_addr32[0] = htonl(in6.s6_addr32[0]);
-	    in6.s6_addr32[1] = htonl(in6.s6_addr32[1]);
-	    in6.s6_addr32[2] = htonl(in6.s6_addr32[2]);
-	    in6.s6_addr32[3] = htonl(in6.s6_addr32[3]);
-        inet_ntop(AF_INET6, &in6, addr6, sizeof(addr6));
-	    inet6_aftype.input(1, addr6, (struct sockaddr *) &mcastaddr);
-	    mcastaddr.sin6_family = AF_INET6;
-	} else {
-	    fprintf(stderr, _("warning, got bogus igmp6 line %d.\n"), lnr);
-	    return;
-	}
+    if (flag_not & FLAG_NUM_HOST)
+	return inet_ntop(family, group, buf, sizeof(buf));
 
-	if ((ap = get_afntype(((struct sockaddr *) &mcastaddr)->sa_family)) == NULL) {
-	    fprintf(stderr, _("netstat: unsupported address family %d !\n"),
-		    ((struct sockaddr *) &mcastaddr)->sa_family);
-	    return;
-	}
-	safe_strncpy(mcast_addr, ap->sprint((struct sockaddr *) &mcastaddr,
-				      flag_not & FLAG_NUM_HOST), sizeof(mcast_addr));
-	printf("%-15s %-6d %s\n", device, refcnt, mcast_addr);
-#endif
-    } else {    /* IPV4 */
-#if HAVE_AFINET
-	if (line[0] != '\t') {
-	    if (idx_flag) {
-		if ((num = sscanf( line, "%d\t%10c", &idx, device)) < 2) {
-		    fprintf(stderr, _("warning, got bogus igmp line %d.\n"), lnr);
-		    return;
-		}
-	    } else {
-		if ( (num = sscanf( line, "%10c", device )) < 1 ) {
-		    fprintf(stderr, _("warning, got bogus igmp line %d.\n"), lnr);
-		    return;
-		}
-	    }
-	    device[10] = '\0';
-	    return;
-	} else if ( line[0] == '\t' ) {
-	    if ( (num = sscanf(line, "\t%8[0-9A-Fa-f] %d", mcast_addr, &refcnt)) < 2 ) {
-		fprintf(stderr, _("warning, got bogus igmp line %d.\n"), lnr);
-		return;
-	    }
-	    sscanf( mcast_addr, "%X",
-		    &((struct sockaddr_in *) &mcastaddr)->sin_addr.s_addr );
-	    ((struct sockaddr *) &mcastaddr)->sa_family = AF_INET;
-	} else {
-	    fprintf(stderr, _("warning, got bogus igmp line %d.\n"), lnr);
-	    return;
-	}
+    for (i = 0; i < alen; i++)
+	h = h * 31 + group[i];
+    n = &igmp_cache[h % IGMP_CACHE_SIZE];
+    if (n->family == family && !memcmp(n->group, group, alen))
+	return n->name;
 
-	if ((ap = get_afntype(((struct sockaddr *) &mcastaddr)->sa_family)) == NULL) {
-	    fprintf(stderr, _("netstat: unsupported address family %d !\n"),
-		    ((struct sockaddr *) &mcastaddr)->sa_family);
-	    return;
-	}
-	safe_strncpy(mcast_addr, ap->sprint((struct sockaddr *) &mcastaddr,
-				      flag_not & FLAG_NUM_HOST), sizeof(mcast_addr));
-	printf("%-15s %-6d %s\n", device, refcnt, mcast_addr );
-#endif
-    }    /* IPV4 */
+    if ((ap = get_afntype(family)) == NULL) {
+	fprintf(stderr, _("netstat: unsupported address family %d !\n"), family);
+	return inet_ntop(family, group, buf, sizeof(buf));
+    }
+    memset(&sas, 0, sizeof(sas));
+    if (family == AF_INET)
+	memcpy(&((struct sockaddr_in *) &sas)->sin_addr, group, 4);
+    else
+	memcpy(&((struct sockaddr_in6 *) &sas)->sin6_addr, group, 16);
+    sas.ss_family = family;
+    n->family = family;
+    memcpy(n->group, group, alen);
+    safe_strncpy(n->name, ap->sprint((struct sockaddr *) &sas, 0), sizeof(n->name));
+    return n->name;
+}
+
+static int igmp_do_one(struct mcast_entry *e, void *arg)
+{
+    printf("%-15s %-6d %s\n", e->iface, e->users, igmp_group(e->family, e->group));
+    return 0;
+}
+
+/* netstat -ge: one row per group with the number of interfaces and users
+   holding it. */
+static int igmp_groups(int family)
+{
+    struct mcast_group *g;
+    int i, n;
+
+    if ((g = mcast_groups(family, &n)) == NULL)
+	return -1;
+    for (i = 0; i < n; i++)
+	printf("%-39s %6d %6ld\n", igmp_group(g[i].family, g[i].group),
+	       g[i].ifaces, g[i].users);
+    free(g);
+    return 0;
 }
 
 #if HAVE_AFX25
@@ -886,8 +864,36 @@ static int x25_info(void)
 
 static int igmp_info(void)
 {
-    INFO_GUTS6(_PATH_PROCNET_IGMP, _PATH_PROCNET_IGMP6, "AF INET (igmp)",
-	       igmp_do_one, "igmp", "igmp6");
+    int rc = 0;
+
+    if (flag_exp > 1) {
+	int family = AF_UNSPEC;
+
+	if (flag_arg && !(flag_inet && flag_inet6))
+	    family = flag_inet ? AF_INET : AF_INET6;
+	if (igmp_groups(family) < 0) {
+	    perror(_PATH_PROCNET_IGMP);
+	    return -1;
+	}
+	return 0;
+    }
+    if (!flag_arg || flag_inet) {
+	if (mcast_read_proc(AF_INET, 0, igmp_do_one, NULL) < 0) {
+	    if (errno != ENOENT) {
+		perror(_PATH_PROCNET_IGMP);
+		return -1;
+	    }
+	    if (!flag_noprot && (flag_arg || flag_ver))
+		ESYSNOT("netstat", "AF INET (igmp)");
+	    if (!flag_noprot && flag_arg)
+		rc = 1;
+	}
+    }
+#if HAVE_AFINET6
+    if (!flag_arg || flag_inet6)
+	mcast_read_proc(AF_INET6, 0, igmp_do_one, NULL);
+#endif
+    return rc;
 }
 
 static const char *sctp_socket_state_str(int state)
@@ -2029,6 +2035,833 @@ static int rfcomm_info(void)
 }
 #endif
 
+/* Per interface rates for netstat -i --rate.  The previous sample is
+   kept in the interface cache, which netstat -c keeps alive. */
+
+struct iface_rate {
+    struct interface *ife;
+    double rx_bps, tx_bps, rx_pps, tx_pps;
+    double rx_drop, tx_drop, rx_err, tx_err;
+    int valid;
+};
+
+struct iface_rate_set {
+    struct iface_rate *r;
+    int n, size;
+    char (*gone)[IFNAMSIZ];	/* removed since the last sample */
+    int ngone, gsize;
+    double dt;
+};
+
+static unsigned long long counter_delta(unsigned long long cur,
+					unsigned long long prev)
+{
+    /* 32 bit counters (32 bit kernels, old /proc/net/dev) wrap at 2^32,
+       for 64 bit counters the unsigned subtraction is already right */
+    if (cur < prev && prev <= 0xffffffffULL)
+	return cur + 0x100000000ULL - prev;
+    return cur - prev;
+}
+
+static char *rate_str(char *buf, size_t len, double v)
+{
+    static const char *unit[] = { "", "K", "M", "G", "T", "P" };
+    int u = 0;
+
+    while (v >= 1000.0 && u < 5) {
+	v /= 1000.0;
+	u++;
+    }
+    if (u == 0)
+	snprintf(buf, len, "%.0f", v);
+    else
+	snprintf(buf, len, "%.1f%s", v, unit[u]);
+    return buf;
+}
+
+static int iface_rate_collect(struct interface *ife, void *cookie)
+{
+    struct iface_rate_set *set = cookie;
+    struct user_net_device_stats *c = &ife->stats, *p = &ife->prev_stats;
+    struct iface_rate *r;
+    double dt = set->dt;
+
+    if (flag_int_name && strcmp(ife->name, flag_int_name))
+	return 0;
+    /* gone since the last sample, or an alias without counters */
+    if (!ife->statistics_valid || (!ife->netlink && if_fetch(ife) < 0)) {
+	if (ife->prev_valid) {
+	    if (set->ngone == set->gsize) {
+		set->gsize = set->gsize ? set->gsize * 2 : 16;
+		set->gone = xrealloc(set->gone, set->gsize * sizeof(*set->gone));
+	    }
+	    safe_strncpy(set->gone[set->ngone++], ife->name, IFNAMSIZ);
+	}
+	ife->prev_valid = 0;
+	return 0;
+    }
+    /* not shown while down; start over when it comes back up, or the
+       first rate would cover all the time it was down */
+    if (!flag_int_name && !(ife->flags & IFF_UP) && !flag_all) {
+	ife->prev_valid = 0;
+	return 0;
+    }
+
+    if (set->n == set->size) {
+	set->size = set->size ? set->size * 2 : 64;
+	set->r = xrealloc(set->r, set->size * sizeof(*set->r));
+    }
+    r = &set->r[set->n++];
+    memset(r, 0, sizeof(*r));
+    r->ife = ife;
+    /* a recreated device comes back with the same name and new counters */
+    if (ife->prev_valid && ife->prev_ifindex == ife->ifindex && dt > 0) {
+	r->valid = 1;
+	r->rx_bps = counter_delta(c->rx_bytes, p->rx_bytes) * 8 / dt;
+	r->tx_bps = counter_delta(c->tx_bytes, p->tx_bytes) * 8 / dt;
+	r->rx_pps = counter_delta(c->rx_packets, p->rx_packets) / dt;
+	r->tx_pps = counter_delta(c->tx_packets, p->tx_packets) / dt;
+	r->rx_drop = counter_delta(c->rx_dropped, p->rx_dropped) / dt;
+	r->tx_drop = counter_delta(c->tx_dropped, p->tx_dropped) / dt;
+	r->rx_err = counter_delta(c->rx_errors, p->rx_errors) / dt;
+	r->tx_err = counter_delta(c->tx_errors, p->tx_errors) / dt;
+    }
+    ife->prev_stats = *c;
+    ife->prev_ifindex = ife->ifindex;
+    ife->prev_valid = 1;
+    return 0;
+}
+
+static int iface_rate_cmp(const void *a, const void *b)
+{
+    const struct iface_rate *ra = a, *rb = b;
+    double ba = ra->rx_bps + ra->tx_bps, bb = rb->rx_bps + rb->tx_bps;
+
+    if (ra->valid != rb->valid)
+	return rb->valid - ra->valid;
+    return ba < bb ? 1 : ba > bb ? -1 : 0;
+}
+
+static int iface_rate_info(void)
+{
+    static struct timespec last;
+    struct timespec now;
+    struct iface_rate_set set;
+    char b[8][16];
+    int i;
+
+    memset(&set, 0, sizeof(set));
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (last.tv_sec || last.tv_nsec)
+	set.dt = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+    last = now;
+
+    if (for_all_interfaces(iface_rate_collect, &set) < 0) {
+	perror(_("missing interface information"));
+	exit(1);
+    }
+    /* the first sample only primes the counters */
+    if (set.dt == 0) {
+	free(set.r);
+	free(set.gone);
+	return 0;
+    }
+    if (flag_busy)
+	qsort(set.r, set.n, sizeof(*set.r), iface_rate_cmp);
+
+    printf(_("Iface         RX-bps   TX-bps   RX-pps   TX-pps RX-drp/s TX-drp/s RX-err/s TX-err/s\n"));
+    for (i = 0; i < set.n; i++) {
+	struct iface_rate *r = &set.r[i];
+
+	printf("%-10.10s ", r->ife->name);
+	if (!r->valid) {
+	    printf(_("   - new -\n"));
+	    continue;
+	}
+	printf("%9s%9s%9s%9s%9s%9s%9s%9s\n",
+	       rate_str(b[0], sizeof(b[0]), r->rx_bps),
+	       rate_str(b[1], sizeof(b[1]), r->tx_bps),
+	       rate_str(b[2], sizeof(b[2]), r->rx_pps),
+	       rate_str(b[3], sizeof(b[3]), r->tx_pps),
+	       rate_str(b[4], sizeof(b[4]), r->rx_drop),
+	       rate_str(b[5], sizeof(b[5]), r->tx_drop),
+	       rate_str(b[6], sizeof(b[6]), r->rx_err),
+	       rate_str(b[7], sizeof(b[7]), r->tx_err));
+    }
+    for (i = 0; i < set.ngone; i++)
+	printf(_("%-10.10s -- removed --\n"), set.gone[i]);
+    free(set.r);
+    free(set.gone);
+    return 0;
+}
+
+/* Per queue statistics for netstat -i --queues.  The queues of a device
+   are the rx-N and tx-N directories below /sys/class/net/<if>/queues,
+   which also hold the RPS and XPS CPU masks.  The counters come from
+   the driver's ethtool statistics when it names them per queue, and
+   for TX from the children of an mq qdisc otherwise. */
+
+struct queue_stat {
+    unsigned long long bytes, packets;
+    int valid;
+    char cpus[64];		/* rps_cpus / xps_cpus as a CPU list */
+};
+
+struct ifq_state {
+    struct ifq_state *next;
+    char name[IFNAMSIZ];
+    int ifindex;
+    int n[2];			/* number of rx and tx queues */
+    struct queue_stat *q[2];
+    struct queue_stat *prev[2];
+};
+
+static struct ifq_state *ifq_states;
+static double ifq_interval;
+
+static const char *ifq_dir[2] = { "rx", "tx" };
+
+static int cpu_range(char *buf, size_t len, int n, int first, int last)
+{
+    if (n >= len)
+	return 0;
+    if (first == last)
+	return snprintf(buf + n, len - n, "%s%d", n ? "," : "", first);
+    return snprintf(buf + n, len - n, "%s%d-%d", n ? "," : "", first, last);
+}
+
+/* "00000000,0000000f" -> "0-3" */
+static void cpumask_to_list(const char *mask, char *buf, size_t len)
+{
+    const char *p = mask + strlen(mask);
+    int cpu = 0, first = -1, n = 0, bit, v;
+
+    buf[0] = '\0';
+    while (p-- > mask) {
+	if (!isxdigit(*p))
+	    continue;
+	v = isdigit(*p) ? *p - '0' : tolower(*p) - 'a' + 10;
+	for (bit = 0; bit < 4; bit++, cpu++) {
+	    if (v & (1 << bit)) {
+		if (first < 0)
+		    first = cpu;
+	    } else if (first >= 0) {
+		n += cpu_range(buf, len, n, first, cpu - 1);
+		first = -1;
+	    }
+	}
+    }
+    if (first >= 0)
+	cpu_range(buf, len, n, first, cpu - 1);
+}
+
+/* Count the rx-N and tx-N queues of an interface. */
+static int ifq_count(const char *name, int n[2])
+{
+    char path[256];
+    struct dirent *de;
+    DIR *d;
+    int i, dir;
+
+    n[0] = n[1] = 0;
+    snprintf(path, sizeof(path), _PATH_SYS_CLASS_NET "/%s/queues", name);
+    if ((d = opendir(path)) == NULL)
+	return -1;
+    while ((de = readdir(d)) != NULL) {
+	if (sscanf(de->d_name, "rx-%d", &i) == 1)
+	    dir = 0;
+	else if (sscanf(de->d_name, "tx-%d", &i) == 1)
+	    dir = 1;
+	else
+	    continue;
+	if (i >= n[dir])
+	    n[dir] = i + 1;
+    }
+    closedir(d);
+    return 0;
+}
+
+static void ifq_cpus(const char *name, int dir, int i, struct queue_stat *q)
+{
+    char path[256], mask[256];
+    FILE *f;
+
+    strcpy(q->cpus, "-");
+    snprintf(path, sizeof(path), _PATH_SYS_CLASS_NET "/%s/queues/%s-%d/%s",
+	     name, ifq_dir[dir], i, dir ? "xps_cpus" : "rps_cpus");
+    /* xps_cpus can't be read on single queue devices */
+    if ((f = fopen(path, "r")) == NULL)
+	return;
+    if (fgets(mask, sizeof(mask), f) != NULL) {
+	cpumask_to_list(mask, q->cpus, sizeof(q->cpus));
+	if (!q->cpus[0])
+	    strcpy(q->cpus, "-");
+    }
+    fclose(f);
+}
+
+/* Recognise the per queue counter names drivers use:
+   rx_queue_0_bytes (virtio, ixgbe), rx-0.bytes (i40e), rx0_bytes (mlx5),
+   queue_0_rx_bytes (ena) and rx_queue_0_xdp_bytes (veth). */
+static int ifq_stat_name(const char *s, int *dir, int *q, int *bytes)
+{
+    static const char *fmt[][2] = {
+	{ "rx_queue_%d_%n", "tx_queue_%d_%n" },
+	{ "rx-%d.%n", "tx-%d.%n" },
+	{ "rx%d_%n", "tx%d_%n" },
+	{ "queue_%d_rx_%n", "queue_%d_tx_%n" },
+    };
+    int f, d, n;
+
+    for (f = 0; f < sizeof(fmt) / sizeof(fmt[0]); f++)
+	for (d = 0; d < 2; d++) {
+	    n = 0;
+	    if (sscanf(s, fmt[f][d], q, &n) != 1 || n == 0)
+		continue;
+	    s += n;
+	    if (!strncmp(s, "xdp_", 4))
+		s += 4;
+	    if (!strcmp(s, "bytes"))
+		*bytes = 1;
+	    else if (!strcmp(s, "packets"))
+		*bytes = 0;
+	    else
+		return 0;
+	    *dir = d;
+	    return 1;
+	}
+    return 0;
+}
+
+static void ifq_ethtool(const char *name, struct ifq_state *st)
+{
+    struct ethtool_drvinfo drv;
+    struct ethtool_gstrings *strs = NULL;
+    struct ethtool_stats *stats = NULL;
+    struct ifreq ifr;
+    unsigned int i;
+    int dir, q, bytes;
+
+    memset(&drv, 0, sizeof(drv));
+    drv.cmd = ETHTOOL_GDRVINFO;
+    safe_strncpy(ifr.ifr_name, name, IFNAMSIZ);
+    ifr.ifr_data = (caddr_t) &drv;
+    if (ioctl(skfd, SIOCETHTOOL, &ifr) < 0 || drv.n_stats == 0)
+	return;
+
+    strs = xmalloc(sizeof(*strs) + drv.n_stats * ETH_GSTRING_LEN);
+    stats = xmalloc(sizeof(*stats) + drv.n_stats * sizeof(__u64));
+    strs->cmd = ETHTOOL_GSTRINGS;
+    strs->string_set = ETH_SS_STATS;
+    strs->len = drv.n_stats;
+    ifr.ifr_data = (caddr_t) strs;
+    if (ioctl(skfd, SIOCETHTOOL, &ifr) < 0)
+	goto out;
+    stats->cmd = ETHTOOL_GSTATS;
+    stats->n_stats = drv.n_stats;
+    ifr.ifr_data = (caddr_t) stats;
+    if (ioctl(skfd, SIOCETHTOOL, &ifr) < 0)
+	goto out;
+
+    for (i = 0; i < drv.n_stats; i++) {
+	char s[ETH_GSTRING_LEN + 1];
+
+	memcpy(s, strs->data + i * ETH_GSTRING_LEN, ETH_GSTRING_LEN);
+	s[ETH_GSTRING_LEN] = '\0';
+	if (!ifq_stat_name(s, &dir, &q, &bytes) || q < 0 || q >= st->n[dir])
+	    continue;
+	if (bytes)
+	    st->q[dir][q].bytes = stats->data[i];
+	else
+	    st->q[dir][q].packets = stats->data[i];
+	st->q[dir][q].valid = 1;
+    }
+out:
+    free(strs);
+    free(stats);
+}
+
+/* TX counters from the per queue children of an mq root qdisc. */
+static void ifq_mq(struct interface *ife, struct ifq_state *st)
+{
+    struct interface_qdisc *qd;
+    unsigned int mq = 0;
+    int q;
+
+    for (qd = ife->qdiscs; qd; qd = qd->next)
+	if (qd->parent == TC_H_ROOT && !strcmp(qd->kind, "mq"))
+	    mq = TC_H_MAJ(qd->handle);
+    if (!mq)
+	return;
+    for (qd = ife->qdiscs; qd; qd = qd->next) {
+	if (TC_H_MAJ(qd->parent) != mq || qd->parent == TC_H_ROOT)
+	    continue;
+	q = TC_H_MIN(qd->parent) - 1;
+	if (q < 0 || q >= st->n[1] || st->q[1][q].valid)
+	    continue;
+	st->q[1][q].bytes = qd->stats.bytes;
+	st->q[1][q].packets = qd->stats.packets;
+	st->q[1][q].valid = 1;
+    }
+}
+
+static struct ifq_state *ifq_state(struct interface *ife, int n[2])
+{
+    struct ifq_state *st;
+    int d;
+
+    for (st = ifq_states; st; st = st->next)
+	if (!strcmp(st->name, ife->name))
+	    break;
+    if (!st) {
+	st = xmalloc(sizeof(*st));
+	memset(st, 0, sizeof(*st));
+	safe_strncpy(st->name, ife->name, sizeof(st->name));
+	st->next = ifq_states;
+	ifq_states = st;
+    }
+    if (st->ifindex != ife->ifindex) {
+	/* a new device under an old name */
+	st->ifindex = ife->ifindex;
+	st->n[0] = st->n[1] = -1;
+    }
+    for (d = 0; d < 2; d++) {
+	if (st->n[d] != n[d]) {
+	    /* queues were added or removed, start over */
+	    free(st->prev[d]);
+	    free(st->q[d]);
+	    st->prev[d] = xmalloc(n[d] * sizeof(struct queue_stat) + 1);
+	    memset(st->prev[d], 0, n[d] * sizeof(struct queue_stat));
+	    st->q[d] = NULL;
+	    st->n[d] = n[d];
+	} else if (st->q[d]) {
+	    struct queue_stat *t = st->prev[d];
+	    st->prev[d] = st->q[d];
+	    st->q[d] = t;
+	}
+	if (!st->q[d])
+	    st->q[d] = xmalloc(n[d] * sizeof(struct queue_stat) + 1);
+	memset(st->q[d], 0, n[d] * sizeof(struct queue_stat));
+    }
+    return st;
+}
+
+static void ifq_print_dir(struct interface *ife, struct ifq_state *st, int d)
+{
+    struct queue_stat *q = st->q[d], *p = st->prev[d];
+    double dt = ifq_interval, total = 0, max = 0, *v;
+    int i, n = st->n[d], counted = 0, hot = -1;
+    char b1[16], b2[16];
+
+    v = xmalloc(n * sizeof(*v) + 1);
+    for (i = 0; i < n; i++) {
+	v[i] = -1;
+	if (!q[i].valid)
+	    continue;
+	if (dt > 0) {
+	    if (!p[i].valid)
+		continue;
+	    v[i] = counter_delta(q[i].packets, p[i].packets) / dt;
+	} else
+	    v[i] = q[i].packets;
+	total += v[i];
+	counted++;
+	if (v[i] > max) {
+	    max = v[i];
+	    hot = i;
+	}
+    }
+
+    for (i = 0; i < n; i++) {
+	char qname[16];
+
+	snprintf(qname, sizeof(qname), "%s-%d", ifq_dir[d], i);
+	printf("%-10.10s %-6s ", ife->name, qname);
+	if (v[i] < 0)
+	    printf("%10s %10s %6s", "-", "-", "-");
+	else if (dt > 0)
+	    printf("%10s %10s %5.1f%%",
+		   rate_str(b1, sizeof(b1), v[i]),
+		   rate_str(b2, sizeof(b2),
+			    counter_delta(q[i].bytes, p[i].bytes) * 8 / dt),
+		   total > 0 ? v[i] * 100 / total : 0.0);
+	else
+	    printf("%10llu %10llu %5.1f%%", q[i].packets, q[i].bytes,
+		   total > 0 ? v[i] * 100 / total : 0.0);
+	printf("  %s %s", d ? "xps" : "rps", q[i].cpus);
+	/* a queue carrying twice its fair share is hot */
+	if (v[i] >= 0 && total > 0 && counted > 1) {
+	    if (v[i] == 0)
+		printf(_(" idle"));
+	    else if (v[i] * counted > 2 * total)
+		printf(_(" HOT"));
+	}
+	printf("\n");
+    }
+    if (counted > 1 && total > 0)
+	printf(_("%-10.10s %s imbalance %.2f (1.00 is even, %d is one queue only), busiest %s-%d\n"),
+	       ife->name, d ? "TX" : "RX", max * counted / total, counted,
+	       ifq_dir[d], hot);
+    free(v);
+}
+
+static int ifq_collect(struct interface *ife, void *cookie)
+{
+    struct ifq_state *st;
+    int n[2], d, i;
+
+    if (strchr(ife->name, ':'))
+	return 0;
+    if (flag_int_name && strcmp(ife->name, flag_int_name))
+	return 0;
+    if (!flag_int_name && !flag_all && !(ife->flags & IFF_UP))
+	return 0;
+    if (ifq_count(ife->name, n) < 0 || n[0] + n[1] == 0)
+	return 0;
+    /* single queue devices have nothing to compare, unless asked for */
+    if (!flag_int_name && !flag_all && n[0] < 2 && n[1] < 2)
+	return 0;
+
+    st = ifq_state(ife, n);
+    for (d = 0; d < 2; d++)
+	for (i = 0; i < n[d]; i++)
+	    ifq_cpus(ife->name, d, i, &st->q[d][i]);
+    ifq_ethtool(ife->name, st);
+    ifq_mq(ife, st);
+
+    for (d = 0; d < 2; d++)
+	if (n[d])
+	    ifq_print_dir(ife, st, d);
+    return 0;
+}
+
+static int iface_queue_info(void)
+{
+    static struct timespec last;
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ifq_interval = 0;
+    if (last.tv_sec || last.tv_nsec)
+	ifq_interval = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+    last = now;
+
+    if (ifq_interval > 0)
+	printf(_("Iface      Queue   Packets/s     Bits/s  Share  CPUs\n"));
+    else
+	printf(_("Iface      Queue     Packets      Bytes  Share  CPUs\n"));
+    if (for_all_interfaces(ifq_collect, NULL) < 0) {
+	perror(_("missing interface information"));
+	exit(1);
+    }
+    return 0;
+}
+
+/* netstat --watch: follow link and address changes as rtnetlink
+   reports them instead of polling.  A copy of the state is kept so that
+   only real changes are printed, and so that after an overrun of the
+   socket buffer a fresh dump can be compared with it. */
+
+#ifndef IFF_LOWER_UP
+#define IFF_LOWER_UP	0x10000
+#endif
+
+#define WATCH_HASH	256
+
+struct watch_link {
+    struct watch_link *next;
+    int ifindex;
+    char name[IFNAMSIZ];
+    unsigned int flags;
+    unsigned int mtu;
+    int seen;
+};
+
+struct watch_addr {
+    struct watch_addr *next;
+    int ifindex;
+    int family;
+    int prefixlen;
+    unsigned char addr[16];
+    int seen;
+};
+
+static struct watch_link *watch_links[WATCH_HASH];
+static struct watch_addr *watch_addrs[WATCH_HASH];
+static int watch_quiet;		/* initial dump, nothing to report */
+static int watch_resync;	/* changes found by a dump after an overrun */
+
+static void watch_event(const char *fmt, ...)
+{
+    char ts[40];
+    va_list ap;
+
+    if (watch_quiet)
+	return;
+    printf("%s ", format_timestamp(ts, sizeof(ts)));
+    va_start(ap, fmt);
+    vprintf(fmt, ap);
+    va_end(ap);
+    if (watch_resync)
+	printf(_(" (resync)"));
+    printf("\n");
+    fflush(stdout);
+}
+
+static struct watch_link *watch_link_find(int ifindex)
+{
+    struct watch_link *l;
+
+    for (l = watch_links[ifindex % WATCH_HASH]; l; l = l->next)
+	if (l->ifindex == ifindex)
+	    return l;
+    return NULL;
+}
+
+static const char *watch_ifname(int ifindex)
+{
+    static char buf[IFNAMSIZ + 8];
+    struct watch_link *l = watch_link_find(ifindex);
+
+    if (l)
+	return l->name;
+    snprintf(buf, sizeof(buf), "if%d", ifindex);
+    return buf;
+}
+
+static void watch_addr_free(int ifindex)
+{
+    struct watch_addr **pp, *a;
+    int h;
+
+    for (h = 0; h < WATCH_HASH; h++)
+	for (pp = &watch_addrs[h]; (a = *pp) != NULL; ) {
+	    if (a->ifindex == ifindex) {
+		*pp = a->next;
+		free(a);
+	    } else
+		pp = &a->next;
+	}
+}
+
+static void watch_link_del(struct watch_link *l)
+{
+    struct watch_link **pp;
+
+    watch_event(_("%s: interface removed"), l->name);
+    watch_addr_free(l->ifindex);
+    for (pp = &watch_links[l->ifindex % WATCH_HASH]; *pp != l; pp = &(*pp)->next)
+	;
+    *pp = l->next;
+    free(l);
+}
+
+static int watch_link_msg(struct nlmsghdr *n)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(n);
+    struct rtattr *tb[IFLA_MAX + 1];
+    struct watch_link *l;
+    unsigned int mtu, changed;
+    const char *name;
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi));
+
+    if (len < 0)
+	return 0;
+    l = watch_link_find(ifi->ifi_index);
+    if (n->nlmsg_type == RTM_DELLINK) {
+	if (l)
+	    watch_link_del(l);
+	return 0;
+    }
+    parse_rtattr(tb, IFLA_MAX, IFLA_RTA(ifi), len);
+    if (!tb[IFLA_IFNAME])
+	return 0;
+    name = RTA_DATA(tb[IFLA_IFNAME]);
+    mtu = tb[IFLA_MTU] ? RTA_U32(tb[IFLA_MTU]) : 0;
+
+    if (!l) {
+	l = xmalloc(sizeof(*l));
+	l->ifindex = ifi->ifi_index;
+	safe_strncpy(l->name, name, sizeof(l->name));
+	l->flags = ifi->ifi_flags;
+	l->mtu = mtu;
+	l->next = watch_links[l->ifindex % WATCH_HASH];
+	watch_links[l->ifindex % WATCH_HASH] = l;
+	watch_event(_("%s: new interface, %s, carrier %s, mtu %u"), l->name,
+		    (l->flags & IFF_UP) ? _("up") : _("down"),
+		    (l->flags & IFF_LOWER_UP) ? _("on") : _("off"), mtu);
+    }
+    l->seen = 1;
+
+    if (strcmp(l->name, name)) {
+	watch_event(_("%s: renamed from %s"), name, l->name);
+	safe_strncpy(l->name, name, sizeof(l->name));
+    }
+    changed = l->flags ^ ifi->ifi_flags;
+    if (changed & IFF_UP)
+	watch_event(_("%s: link %s"), name,
+		    (ifi->ifi_flags & IFF_UP) ? _("up") : _("down"));
+    if (changed & IFF_LOWER_UP)
+	watch_event(_("%s: carrier %s"), name,
+		    (ifi->ifi_flags & IFF_LOWER_UP) ? _("on") : _("off"));
+    if (changed & IFF_PROMISC)
+	watch_event(_("%s: promiscuous mode %s"), name,
+		    (ifi->ifi_flags & IFF_PROMISC) ? _("on") : _("off"));
+    if (mtu && mtu != l->mtu)
+	watch_event(_("%s: mtu %u -> %u"), name, l->mtu, mtu);
+    l->flags = ifi->ifi_flags;
+    if (mtu)
+	l->mtu = mtu;
+    return 0;
+}
+
+static int watch_addr_msg(struct nlmsghdr *n)
+{
+    struct ifaddrmsg *ifa = NLMSG_DATA(n);
+    struct rtattr *tb[IFA_MAX + 1], *rta;
+    struct watch_addr *a, **pp;
+    char buf[INET6_ADDRSTRLEN];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*ifa));
+    int alen, h;
+
+    if (len < 0 || (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6))
+	return 0;
+    parse_rtattr(tb, IFA_MAX, IFA_RTA(ifa), len);
+    /* IFA_ADDRESS is the peer on point-to-point links */
+    rta = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+    alen = ifa->ifa_family == AF_INET ? 4 : 16;
+    if (!rta || RTA_PAYLOAD(rta) < alen)
+	return 0;
+
+    h = (ifa->ifa_index + ((unsigned char *) RTA_DATA(rta))[alen - 1]) % WATCH_HASH;
+    for (pp = &watch_addrs[h]; (a = *pp) != NULL; pp = &a->next)
+	if (a->ifindex == ifa->ifa_index && a->family == ifa->ifa_family &&
+	    a->prefixlen == ifa->ifa_prefixlen &&
+	    !memcmp(a->addr, RTA_DATA(rta), alen))
+	    break;
+    inet_ntop(ifa->ifa_family, RTA_DATA(rta), buf, sizeof(buf));
+
+    if (n->nlmsg_type == RTM_DELADDR) {
+	if (a) {
+	    watch_event(_("%s: %s %s/%d removed"), watch_ifname(a->ifindex),
+			a->family == AF_INET ? "inet" : "inet6", buf, a->prefixlen);
+	    *pp = a->next;
+	    free(a);
+	}
+	return 0;
+    }
+    if (!a) {
+	a = xmalloc(sizeof(*a));
+	a->ifindex = ifa->ifa_index;
+	a->family = ifa->ifa_family;
+	a->prefixlen = ifa->ifa_prefixlen;
+	memcpy(a->addr, RTA_DATA(rta), alen);
+	a->next = watch_addrs[h];
+	watch_addrs[h] = a;
+	watch_event(_("%s: %s %s/%d added"), watch_ifname(a->ifindex),
+		    a->family == AF_INET ? "inet" : "inet6", buf, a->prefixlen);
+    }
+    a->seen = 1;
+    return 0;
+}
+
+static int watch_msg(struct nlmsghdr *n, void *arg)
+{
+    switch (n->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+	return watch_link_msg(n);
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+	return watch_addr_msg(n);
+    }
+    return 0;
+}
+
+/* Dump links and addresses and report whatever differs from what we
+   knew, including things that are gone. */
+static int watch_dump(void)
+{
+    struct rtnl_handle rth;
+    struct watch_link *l, *ln;
+    struct watch_addr *a, **pp;
+    char buf[INET6_ADDRSTRLEN];
+    int h, err = -1;
+
+    for (h = 0; h < WATCH_HASH; h++) {
+	for (l = watch_links[h]; l; l = l->next)
+	    l->seen = 0;
+	for (a = watch_addrs[h]; a; a = a->next)
+	    a->seen = 0;
+    }
+    if (rtnl_open(&rth, 0) < 0)
+	return -1;
+    if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETLINK) < 0 ||
+	rtnl_dump_filter(&rth, watch_msg, NULL) < 0)
+	goto out;
+    if (rtnl_wilddump_request(&rth, AF_UNSPEC, RTM_GETADDR) < 0 ||
+	rtnl_dump_filter(&rth, watch_msg, NULL) < 0)
+	goto out;
+    err = 0;
+
+    for (h = 0; h < WATCH_HASH; h++)
+	for (pp = &watch_addrs[h]; (a = *pp) != NULL; ) {
+	    if (a->seen) {
+		pp = &a->next;
+		continue;
+	    }
+	    inet_ntop(a->family, a->addr, buf, sizeof(buf));
+	    watch_event(_("%s: %s %s/%d removed"), watch_ifname(a->ifindex),
+			a->family == AF_INET ? "inet" : "inet6", buf, a->prefixlen);
+	    *pp = a->next;
+	    free(a);
+	}
+    for (h = 0; h < WATCH_HASH; h++)
+	for (l = watch_links[h]; l; l = ln) {
+	    ln = l->next;
+	    if (!l->seen)
+		watch_link_del(l);
+	}
+out:
+    rtnl_close(&rth);
+    return err;
+}
+
+static int iface_watch(void)
+{
+    struct rtnl_handle rth;
+
+    /* subscribe before the dump, so nothing falls in between */
+    if (rtnl_open(&rth, RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR) < 0) {
+	perror("rtnetlink");
+	return 1;
+    }
+    watch_quiet = 1;
+    if (watch_dump() < 0) {
+	perror("rtnetlink");
+	return 1;
+    }
+    watch_quiet = 0;
+
+    for (;;) {
+	if (rtnl_listen(&rth, watch_msg, NULL) == 0)
+	    break;
+	if (errno != ENOBUFS) {
+	    perror("rtnetlink");
+	    break;
+	}
+	/* the kernel had to drop notifications, find out what we missed */
+	watch_event(_("event queue overrun, resyncing"));
+	rtnl_drain(&rth);
+	watch_resync = 1;
+	if (watch_dump() < 0)
+	    perror("rtnetlink");
+	watch_resync = 0;
+    }
+    rtnl_close(&rth);
+    return 1;
+}
+
 static int iface_info(void)
 {
     static int count=0;
@@ -2041,21 +2874,28 @@ static int iface_info(void)
 	}
 	printf(_("Kernel Interface table\n"));
     }
-    if (flag_exp < 2) {
-	ife_short = 1;
-	if(!(count % 8))
-	    printf(_("Iface      MTU    RX-OK RX-ERR RX-DRP RX-OVR    TX-OK TX-ERR TX-DRP TX-OVR Flg\n"));
-    }
+    if (flag_queues)
+	iface_queue_info();
+    else if (flag_rate)
+	iface_rate_info();
+    else {
+	if (flag_exp < 2) {
+	    ife_short = 1;
+	    if(!(count % 8))
+		printf(_("Iface      MTU    RX-OK RX-ERR RX-DRP RX-OVR    TX-OK TX-ERR TX-DRP TX-OVR Flg\n"));
+	}
 
-    if (flag_int_name) {
-        ife = lookup_interface(flag_int_name);
-        do_if_print(ife, &flag_all);
-    }
-    else if (for_all_interfaces(do_if_print, &flag_all) < 0) {
-	perror(_("missing interface information"));
-	exit(1);
+	if (flag_int_name) {
+	    ife = lookup_interface(flag_int_name);
+	    do_if_print(ife, &flag_all);
+	}
+	else if (for_all_interfaces(do_if_print, &flag_all) < 0) {
+	    perror(_("missing interface information"));
+	    exit(1);
+	}
     }
-    if (!flag_cnt) {
+    /* rates compare against the cached previous sample */
+    if (!flag_cnt && !flag_rate) {
 	if_cache_free();
 	close(skfd);
 	skfd = -1;
@@ -2077,13 +2917,21 @@ static void usage(void)
 {
     fprintf(stderr, _("usage: netstat [-vWeenNcCF] [<Af>] -r         netstat {-V|--version|-h|--help}\n"));
     fprintf(stderr, _("       netstat [-vWnNcaeol] [<Socket> ...]\n"));
-    fprintf(stderr, _("       netstat { [-vWeenNac] -I[<Iface>] | [-veenNac] -i | [-cnNe] -M | -s [-6tuw] } [delay]\n\n"));
+    fprintf(stderr, _("       netstat { [-vWeenNac] -I[<Iface>] | [-veenNac] -i | [-cnNe] -M | -s [-6tuw] } [delay]\n"));
+    fprintf(stderr, _("       netstat -i --rate [--busiest] [-ac] [delay]\n"));
+    fprintf(stderr, _("       netstat { -i | -I<Iface> } --queues [-ac] [delay]\n"));
+    fprintf(stderr, _("       netstat --softnet [-c] [delay]\n"));
+    fprintf(stderr, _("       netstat --watch | netstat -r [-ne] [<Af>] --watch [-c] [delay]\n\n"));
 
     fprintf(stderr, _("        -r, --route              display routing table\n"));
     fprintf(stderr, _("        -I, --interfaces=<Iface> display interface table for <Iface>\n"));
     fprintf(stderr, _("        -i, --interfaces         display interface table\n"));
+    fprintf(stderr, _("        --rate [--busiest]       display interface throughput and error rates\n"));
+    fprintf(stderr, _("        --queues                 display per RX/TX queue statistics\n"));
     fprintf(stderr, _("        -g, --groups             display multicast group memberships\n"));
     fprintf(stderr, _("        -s, --statistics         display networking statistics (like SNMP)\n"));
+    fprintf(stderr, _("        --softnet                display per-CPU softnet backlog statistics\n"));
+    fprintf(stderr, _("        --watch                  display link and address (with -r: route) changes\n"));
 #if HAVE_FW_MASQUERADE
     fprintf(stderr, _("        -M, --masquerade         display masqueraded connections\n\n"));
 #endif
@@ -2103,6 +2951,7 @@ static void usage(void)
     fprintf(stderr, _("        -a, --all                display all sockets (default: connected)\n"));
     fprintf(stderr, _("        -F, --fib                display Forwarding Information Base (default)\n"));
     fprintf(stderr, _("        -C, --cache              display routing cache instead of FIB\n"));
+    fprintf(stderr, _("        --table <table>          with -r, list a routing table ('all' for all)\n"));
 #if HAVE_SELINUX
     fprintf(stderr, _("        -Z, --context            display SELinux security context for sockets\n"));
 #endif
@@ -2148,6 +2997,11 @@ int main
 	{"programs", 0, 0, 'p'},
 	{"verbose", 0, 0, 'v'},
 	{"statistics", 0, 0, 's'},
+	{"softnet", 0, 0, '%'},
+	{"rate", 0, 0, '^'},
+	{"busiest", 0, 0, '&'},
+	{"queues", 0, 0, '*'},
+	{"watch", 0, 0, '~'},
 	{"wide", 0, 0, 'W'},
 	{"numeric", 0, 0, 'n'},
 	{"numeric-hosts", 0, 0, '!'},
@@ -2156,6 +3010,7 @@ int main
 	{"symbolic", 0, 0, 'N'},
 	{"cache", 0, 0, 'C'},
 	{"fib", 0, 0, 'F'},
+	{"table", 1, 0, 'T'},
 	{"groups", 0, 0, 'g'},
 	{"context", 0, 0, 'Z'},
 	{NULL, 0, 0, 0}
@@ -2244,6 +3099,12 @@ int main
 	case 'F':
 	    flag_cf |= FLAG_FIB;
 	    break;
+	case 'T':
+	    if (route_parse_table(optarg, &route_table) < 0) {
+		fprintf(stderr, _("netstat: unknown routing table `%s'\n"), optarg);
+		exit(1);
+	    }
+	    break;
 	case 'o':
 	    flag_opt++;
 	    break;
@@ -2308,6 +3169,22 @@ int main
 	    usage();
 	case 's':
 	    flag_sta++;
+	    break;
+	case '%':
+	    flag_softnet++;
+	    break;
+	case '&':
+	    flag_busy++;
+	    /* fall through */
+	case '^':
+	    flag_rate = 1;
+	    break;
+	case '*':
+	    flag_queues = 1;
+	    break;
+	case '~':
+	    flag_watch = 1;
+	    break;
 	}
 
     if(argc == optind + 1) {
@@ -2316,7 +3193,13 @@ int main
       flag_cnt++;
     }
     
-    if (flag_int + flag_rou + flag_mas + flag_sta > 1)
+    /* --rate and --queues work on the interface table, with or without -i */
+    if ((flag_rate || flag_queues) && !flag_int)
+	flag_int = 1;
+
+    /* -r --watch follows the routing tables instead of the interfaces */
+    if (flag_int + flag_rou + flag_mas + flag_sta + flag_softnet +
+	(flag_watch && !flag_rou) > 1)
 	usage();
 
     if ((flag_inet || flag_inet6 || flag_sta) &&
@@ -2384,6 +3267,16 @@ int main
         return (i);
     }
 
+    if (flag_softnet) {
+	for (;;) {
+	    i = parsesoftnet(flag_cnt ? reptimer : 0);
+	    if (i || !flag_cnt)
+		break;
+	    wait_continous(reptimer);
+	}
+	return (i);
+    }
+
     if (flag_rou) {
 	int options = 0;
 
@@ -2399,6 +3292,8 @@ int main
 	if (!flag_cf)
 	    options |= FLAG_FIB;
 
+	if (flag_watch)
+	    return (route_monitor(afname, options, flag_cnt ? reptimer : 0));
 	for (;;) {
 	    i = route_info(afname, options);
 	    if (i || !flag_cnt)
@@ -2407,7 +3302,18 @@ int main
 	}
 	return (i);
     }
+    if (flag_watch)
+	return (iface_watch());
+
     if (flag_int) {
+	/* -ie also shows the qdisc counters, as rates with -c */
+	if ((flag_exp > 1 && !flag_rate) || flag_queues)
+	    if_qdisc_stats = 1;
+	if (flag_rate) {
+	    /* rates need a first sample to compare with */
+	    iface_info();
+	    wait_continous(reptimer);
+	}
 	for (;;) {
 	    i = iface_info();
 	    if (!flag_cnt || i)
@@ -2481,8 +3387,13 @@ int main
 	    printf( "IPv6/");
 #endif
 	    printf( _("IPv4 Group Memberships\n") );
-	    printf( _("Interface       RefCnt Group\n") );
-	    printf( "--------------- ------ ---------------------\n" );
+	    if (flag_exp > 1) {
+		printf( _("Group                                   Ifaces  Users\n") );
+		printf( "--------------------------------------- ------ ------\n" );
+	    } else {
+		printf( _("Interface       RefCnt Group\n") );
+		printf( "--------------- ------ ---------------------\n" );
+	    }
 	    i = igmp_info();
 	    if (i)
 	        return (i);
@@ -61,6 +61,7 @@
 #include "pathnames.h"
 #include "version.h"
 #include "util.h"
+#include "fib.h"
 
 #define DFLT_AF "inet"
 
@@ -73,13 +74,24 @@ int opt_n = 0;     // numerical output FLAG_NUM | FLAG_SYM
 int opt_v = 0;     // debugging output flag
 int opt_e = 1;     // 1,2,3=type of routetable
 int opt_fc = 0;    // routing cache/FIB
+int opt_proc = 0;  // read /proc instead of rtnetlink
+int opt_stats = 0; // --stats: counts instead of the table
+char *opt_save;    // --save: binary snapshot of the tables
+char *opt_diff;    // --diff: compare snapshots
+char *opt_file;    // -f: batch of route changes
 int opt_h = 0;     // help selected
 struct aftype *ap; // selected address family
 
 static void usage(void)
 {
-    fprintf(stderr, _("Usage: route [-nNvee] [-FC] [<AF>]           List kernel routing tables\n"));
-    fprintf(stderr, _("       route [-v] [-FC] {add|del|flush} ...  Modify routing table for AF.\n\n"));
+    fprintf(stderr, _("Usage: route [-nNvee] [-FC] [-T table] [<AF>] List kernel routing tables\n"));
+    fprintf(stderr, _("       route [-nv] [<AF>] -C [prefix]          List route exceptions (cache).\n"));
+    fprintf(stderr, _("       route [-v] [-FC] {add|del|flush} ...  Modify routing table for AF.\n"));
+    fprintf(stderr, _("       route [-nve] [-T table] lookup [file] Longest prefix match for addresses.\n"));
+    fprintf(stderr, _("       route [-v] [-T table] -f {file|-}     Add/del routes listed in file.\n"));
+    fprintf(stderr, _("       route [-ne] [-T table] monitor [secs] Print route changes as they happen.\n"));
+    fprintf(stderr, _("       route [-v] [-T table] --save {file|-} Save a binary snapshot of the tables.\n"));
+    fprintf(stderr, _("       route [-v] --diff <file> [file]       Compare a snapshot with another or the tables.\n\n"));
 
     fprintf(stderr, _("       route {-h|--help} [<AF>]              Detailed usage syntax for specified AF.\n"));
     fprintf(stderr, _("       route {-V|--version}                  Display version/author and exit.\n\n"));
@@ -88,7 +100,10 @@ static void usage(void)
     fprintf(stderr, _("        -n, --numeric            don't resolve names\n"));
     fprintf(stderr, _("        -e, --extend             display other/more information\n"));
     fprintf(stderr, _("        -F, --fib                display Forwarding Information Base (default)\n"));
-    fprintf(stderr, _("        -C, --cache              display routing cache instead of FIB\n\n"));
+    fprintf(stderr, _("        -C, --cache              display routing cache instead of FIB\n"));
+    fprintf(stderr, _("        -T, --table <table>      list table (number, name or 'all') via rtnetlink\n"));
+    fprintf(stderr, _("            --proc               read /proc instead of rtnetlink\n"));
+    fprintf(stderr, _("            --stats              route counts per prefix length, gateway, ...\n\n"));
 
     fprintf(stderr, _("  <AF>=Use -4, -6, '-A <af>' or '--<af>'; default: %s\n"), DFLT_AF);
     fprintf(stderr, _("  List of possible address families (which support routing):\n"));
@@ -118,6 +133,12 @@ int main(int argc, char **argv)
 	{"protocol", 1, 0, 'A'},
 	{"cache", 0, 0, 'C'},
 	{"fib", 0, 0, 'F'},
+	{"table", 1, 0, 'T'},
+	{"proc", 0, 0, 'P'},
+	{"file", 1, 0, 'f'},
+	{"stats", 0, 0, 'S'},
+	{"save", 1, 0, 'W'},
+	{"diff", 1, 0, 'D'},
 	{"help", 0, 0, 'h'},
 	{NULL, 0, 0, 0}
     };
@@ -141,7 +162,7 @@ int main(int argc, char **argv)
     }
 
     /* Fetch the command-line arguments. */
-    while ((i = getopt_long(argc, argv, "A:eCFhnN64Vv?", longopts, &lop)) != EOF)
+    while ((i = getopt_long(argc, argv, "A:eCFf:hnN64T:Vv?", longopts, &lop)) != EOF)
 	switch (i) {
 	case -1:
 	    break;
@@ -171,6 +192,27 @@ int main(int argc, char **argv)
 	case 'F':
 	    opt_fc |= FLAG_FIB;
 	    break;
+	case 'T':
+	    if (route_parse_table(optarg, &route_table) < 0) {
+		fprintf(stderr, _("route: unknown routing table `%s'\n"), optarg);
+		exit(E_OPTERR);
+	    }
+	    break;
+	case 'P':
+	    opt_proc = FLAG_PROC;
+	    break;
+	case 'f':
+	    opt_file = optarg;
+	    break;
+	case 'S':
+	    opt_stats = 1;
+	    break;
+	case 'W':
+	    opt_save = optarg;
+	    break;
+	case 'D':
+	    opt_diff = optarg;
+	    break;
 	case 'A':
 	    if ((i = aftrans_opt(optarg)))
 		exit(i);
@@ -202,12 +244,23 @@ int main(int argc, char **argv)
 	else
 	    what = RTACTION_HELP;
     } else {
+	int af_given = afname[0] != '\0';
+
 	if (!afname[0])
 	    /* this will initialise afname[] */
 	    aftrans_def("route", progname, DFLT_AF);
 
 	/* Do we have to show the contents of the routing table? */
-	if (*argv == NULL) {
+	if (opt_save || opt_diff) {
+	    /* snapshots hold both families unless told otherwise */
+	    if (!af_given)
+		safe_strncpy(afname, "inet,inet6", sizeof(afname));
+	    if ((opt_save && *argv != NULL) || (opt_diff && *argv && argv[1]))
+		usage();
+	} else if (opt_file) {
+	    if (*argv != NULL)
+		usage();
+	} else if (*argv == NULL) {
 	    what = RTACTION_SHOW;
 	} else {
 	    if (!strcmp(*argv, "add"))
@@ -216,17 +269,44 @@ int main(int argc, char **argv)
 		what = RTACTION_DEL;
 	    else if (!strcmp(*argv, "flush"))
 		what = RTACTION_FLUSH;
-	    else
+	    else if (!strcmp(*argv, "lookup"))
+		what = RTACTION_LOOKUP;
+	    else if (!strcmp(*argv, "monitor"))
+		what = RTACTION_MONITOR;
+	    else if ((opt_fc & FLAG_CACHE) && !argv[1] &&
+		     route_parse_prefix(*argv, &route_cache_prefix) == 0) {
+		/* route -C prefix: the family follows the prefix */
+		what = RTACTION_SHOW;
+		if (!af_given && route_cache_prefix.family == AF_INET6)
+		    safe_strncpy(afname, "inet6", sizeof(afname));
+	    } else
 		usage();
 	}
     }
 
-    options = (opt_e & FLAG_EXT) | opt_n | opt_fc | opt_v;
+    options = (opt_e & FLAG_EXT) | opt_n | opt_fc | opt_v | opt_proc;
     if (!opt_fc)
 	options |= FLAG_FIB;
 
-    if (what == RTACTION_SHOW)
+    if (opt_save && what != RTACTION_HELP)
+	i = route_save(opt_save, afname, options);
+    else if (opt_diff && what != RTACTION_HELP)
+	i = route_diff(opt_diff, *argv, afname, options);
+    else if (opt_file && what != RTACTION_HELP)
+	i = route_batch(opt_file, afname, options);
+    else if (what == RTACTION_SHOW && opt_stats)
+	i = route_stats(afname, options);
+    else if (what == RTACTION_SHOW)
 	i = route_info(afname, options);
+    else if (what == RTACTION_LOOKUP)
+	i = route_lookup(options, argv[1]);
+    else if (what == RTACTION_MONITOR) {
+	int interval = 0;
+
+	if (argv[1] && (argv[2] || (interval = atoi(argv[1])) <= 0))
+	    usage();
+	i = route_monitor(afname, options, interval);
+    }
     else
 	i = route_edit(what, afname, options, ++argv);
 
@@ -4,6 +4,7 @@
  * 19980630 - i18n - Arnaldo Carvalho de Melo <acme@conectiva.com.br>
  * 19981113 - i18n fixes - Arnaldo Carvalho de Melo <acme@conectiva.com.br>
  * 19990101 - added net/netstat, -t, -u, -w supprt - Bernd Eckenfels
+ * 20261019 - added --softnet per-CPU backlog statistics
  */
 #include <ctype.h>
 #include <stdio.h>
@@ -12,6 +13,7 @@
 #include "config.h"
 #include "intl.h"
 #include "proc.h"
+#include "util.h"
 
 /* #define WARN 1 */
 
@@ -652,3 +654,167 @@ void inittab6(void)
               sizeof(struct entry), cmpentries);
 }
 
+/*
+ * Per-CPU softnet statistics from /proc/net/softnet_stat.  Every line is
+ * one online CPU, all columns are 32 bit hex counters:
+ *   processed dropped time_squeeze 0 0 0 0 0 cpu_collision received_rps
+ *   flow_limit_count [backlog_len cpu_index]
+ * Old kernels stop after cpu_collision or received_rps, new ones append
+ * the current backlog length and the real CPU number (offline CPUs are
+ * skipped, so the line number is not always the CPU number).
+ */
+#define SOFTNET_COLS 13
+
+struct softnet_cpu {
+    int cpu;
+    unsigned int processed;
+    unsigned int dropped;
+    unsigned int squeezed;
+    unsigned int collision;
+    unsigned int rps;
+    unsigned int flow_limit;
+    unsigned int backlog;
+};
+
+static struct softnet_cpu *softnet_prev;
+static int softnet_nprev;
+
+static int softnet_read(struct softnet_cpu **cpus)
+{
+    FILE *f;
+    char buf[512];
+    int n = 0, size = 0;
+    struct softnet_cpu *sc = NULL;
+
+    f = proc_fopen("/proc/net/softnet_stat");
+    if (!f) {
+	perror(_("cannot open /proc/net/softnet_stat"));
+	return -1;
+    }
+    while (fgets(buf, sizeof buf, f)) {
+	unsigned int col[SOFTNET_COLS];
+	char *p = buf, *end;
+	int i;
+
+	for (i = 0; i < SOFTNET_COLS; i++) {
+	    col[i] = strtoul(p, &end, 16);
+	    if (end == p)
+		break;
+	    p = end;
+	}
+	if (i < 3)
+	    continue;
+	if (n == size) {
+	    size = size ? size * 2 : 64;
+	    sc = xrealloc(sc, size * sizeof(*sc));
+	}
+	memset(&sc[n], 0, sizeof(*sc));
+	sc[n].cpu = i > 12 ? (int)col[12] : n;
+	sc[n].processed = col[0];
+	sc[n].dropped = col[1];
+	sc[n].squeezed = col[2];
+	if (i > 8)
+	    sc[n].collision = col[8];
+	if (i > 9)
+	    sc[n].rps = col[9];
+	if (i > 10)
+	    sc[n].flow_limit = col[10];
+	if (i > 11)
+	    sc[n].backlog = col[11];
+	n++;
+    }
+    if (ferror(f)) {
+	perror("/proc/net/softnet_stat");
+	fclose(f);
+	free(sc);
+	return -1;
+    }
+    fclose(f);
+    *cpus = sc;
+    return n;
+}
+
+static struct softnet_cpu *softnet_find_prev(int cpu, int hint)
+{
+    int i;
+
+    if (hint < softnet_nprev && softnet_prev[hint].cpu == cpu)
+	return &softnet_prev[hint];
+    for (i = 0; i < softnet_nprev; i++)
+	if (softnet_prev[i].cpu == cpu)
+	    return &softnet_prev[i];
+    return NULL;
+}
+
+/*
+ * Print one table of softnet counters.  With interval > 0 the previous
+ * sample is kept and per second rates since then are shown instead of
+ * the absolute values; the counters are 32 bit and wrap, which the
+ * unsigned subtraction takes care of.
+ */
+int parsesoftnet(int interval)
+{
+    struct softnet_cpu *cur, *prev, *d;
+    unsigned long long total_proc = 0, total_drop = 0, total_sqz = 0,
+	total_rps = 0, total_flow = 0;
+    int n, i, rate;
+
+    n = softnet_read(&cur);
+    if (n < 0)
+	return 1;
+
+    rate = interval > 0 && softnet_prev != NULL;
+    if (!rate)
+	interval = 1;
+
+    /* turn the previous sample into deltas, we need the total for Share */
+    d = xmalloc(n * sizeof(*d));
+    for (i = 0; i < n; i++) {
+	d[i] = cur[i];
+	prev = rate ? softnet_find_prev(cur[i].cpu, i) : NULL;
+	if (prev) {
+	    d[i].processed -= prev->processed;
+	    d[i].dropped -= prev->dropped;
+	    d[i].squeezed -= prev->squeezed;
+	    d[i].rps -= prev->rps;
+	    d[i].flow_limit -= prev->flow_limit;
+	}
+	total_proc += d[i].processed;
+	total_drop += d[i].dropped;
+	total_sqz += d[i].squeezed;
+	total_rps += d[i].rps;
+	total_flow += d[i].flow_limit;
+    }
+
+    if (rate)
+	printf(_("Softnet statistics (per CPU, per second)\n"));
+    else
+	printf(_("Softnet statistics (per CPU)\n"));
+    printf(_("CPU    Processed    Dropped   Squeezed   RPS-Recv  FlowLimit Backlog  Share Flg\n"));
+
+    for (i = 0; i < n; i++) {
+	printf("%-4d %11u %10u %10u %10u %10u %7u %5.1f%% ",
+	       d[i].cpu, d[i].processed / interval, d[i].dropped / interval,
+	       d[i].squeezed / interval, d[i].rps / interval,
+	       d[i].flow_limit / interval, d[i].backlog,
+	       total_proc ? 100.0 * d[i].processed / total_proc : 0.0);
+	/* D: backlog overflow drops, S: net_rx_action ran out of budget,
+	   F: flow limit hit.  These are the CPUs to look at. */
+	if (d[i].dropped)
+	    printf("D");
+	if (d[i].squeezed)
+	    printf("S");
+	if (d[i].flow_limit)
+	    printf("F");
+	printf("\n");
+    }
+    printf("%-4s %11llu %10llu %10llu %10llu %10llu\n", _("all"),
+	   total_proc / interval, total_drop / interval, total_sqz / interval,
+	   total_rps / interval, total_flow / interval);
+
+    free(d);
+    free(softnet_prev);
+    softnet_prev = cur;
+    softnet_nprev = n;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# tests/route-monitor.sh	Check that the copy of the IPv4 table kept by
+#				"route monitor <interval>" follows append,
+#				prepend, replace, delete and TOS routes.
+#
+# Needs root and ip(8); runs in a scratch network namespace.
+#
+# Usage: tests/route-monitor.sh [path to route]
+
+ROUTE=${1:-./route}
+NS=nt-route-mon.$$
+OUT=/tmp/$NS.out
+
+ip netns add $NS || exit 77
+trap 'kill $MON 2>/dev/null; ip netns del $NS; rm -f $OUT' 0
+ns() { ip netns exec $NS "$@"; }
+
+ns ip link add name a type veth peer name b
+ns ip link set dev a up
+ns ip link set dev b up
+ns ip addr add 10.1.1.1/24 dev a
+ns ip route add 10.4.0.0/16 via 10.1.1.2
+
+ns $ROUTE -n -A inet monitor 1 > $OUT &
+MON=$!
+sleep 1
+
+ns ip route add 10.5.0.0/16 via 10.1.1.2
+ns ip route append 10.5.0.0/16 via 10.1.1.3
+ns ip route append 10.5.0.0/16 via 10.1.1.4
+ns ip route prepend 10.5.0.0/16 via 10.1.1.5
+ns ip route replace 10.5.0.0/16 via 10.1.1.9
+ns ip route del 10.5.0.0/16 via 10.1.1.3
+ns ip route add 10.6.0.0/16 tos 0x10 via 10.1.1.2
+ns ip route add 10.6.0.0/16 via 10.1.1.2
+ns ip route replace 10.6.0.0/16 tos 0x10 via 10.1.1.3
+ns ip route replace 10.4.0.0/16 via 10.1.1.3
+ns ip route del 10.4.0.0/16
+sleep 2.5
+
+want=$(ns ip route show table main | wc -l)
+got=$(sed -n 's/.* summary IPv4 \([0-9]*\) routes.*/\1/p' $OUT | tail -n 1)
+if [ "$got" != "$want" ]; then
+    echo "route monitor: summary has ${got:-no} routes, the kernel $want"
+    cat $OUT
+    exit 1
+fi
+echo "route monitor: $got routes, ok"
+exit 0